@@ -37,6 +37,9 @@ struct BenchmarkSetup {
 
 BenchmarkSetup setup_benchmark(std::istream&);
 
+// Games of consecutive positions used by speedtest and nnuebench
+const std::vector<std::vector<std::string>>& benchmark_games();
+
 }  // namespace Judas
 
 #endif  // #ifndef BENCHMARK_H_INCLUDED
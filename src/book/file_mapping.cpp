@@ -23,13 +23,14 @@ FileMapping::FileMapping() :
 
 FileMapping::~FileMapping() { unmap(); }
 
-bool FileMapping::map(const std::string& f, bool verbose) {
+bool FileMapping::map(const std::string& f, bool verbose, bool sequential) {
     unmap();
 
 #ifdef _WIN32
-    // Note FILE_FLAG_RANDOM_ACCESS is only a hint to Windows and as such may get ignored.
+    // Note the access flags are only a hint to Windows and as such may get ignored.
     HANDLE fd = CreateFile(f.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
-                           FILE_FLAG_RANDOM_ACCESS, nullptr);
+                           sequential ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS,
+                           nullptr);
 
     if (fd == INVALID_HANDLE_VALUE)
     {
@@ -117,8 +118,8 @@ bool FileMapping::map(const std::string& f, bool verbose) {
         return false;
     }
 
-    #if defined(MADV_RANDOM)
-    madvise(data, statbuf.st_size, MADV_RANDOM);
+    #if defined(MADV_RANDOM) && defined(MADV_SEQUENTIAL)
+    madvise(data, statbuf.st_size, sequential ? MADV_SEQUENTIAL : MADV_RANDOM);
     #endif
     ::close(fd);
 
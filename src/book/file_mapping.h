@@ -14,7 +14,7 @@ class FileMapping {
     FileMapping();
     ~FileMapping();
 
-    bool map(const std::string& f, bool verbose);
+    bool map(const std::string& f, bool verbose, bool sequential = false);
     void unmap();
 
     bool                 has_data() const;
@@ -0,0 +1,176 @@
+/*
+  JudaS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  JudaS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  JudaS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Launcher for dispatch builds (make dispatch-build). The engine is compiled
+// once per x86-64 architecture as judas-<arch>, and this small program, built
+// with baseline flags, runs the fastest one the host CPU supports. The chosen
+// architecture is passed in JUDAS_DISPATCH and shown by the 'compiler' command.
+
+#include <cstdlib>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
+
+namespace {
+
+struct Candidate {
+    const char* arch;
+    bool (*supported)();
+};
+
+bool is_slow_pext_cpu() {
+    // PEXT/PDEP are microcoded and slow before Zen 3
+    return __builtin_cpu_is("amd") && (__builtin_cpu_is("znver1") || __builtin_cpu_is("znver2"));
+}
+
+// Each check covers every instruction set the Makefile enables for the arch,
+// including those inherited from the less advanced ones. A hypervisor may hide
+// any of them, so none is implied by another.
+bool has_sse41_popcnt() {
+    return __builtin_cpu_supports("sse3") && __builtin_cpu_supports("ssse3")
+        && __builtin_cpu_supports("sse4.1") && __builtin_cpu_supports("popcnt");
+}
+
+bool has_avx2() {
+    return has_sse41_popcnt() && __builtin_cpu_supports("avx2") && __builtin_cpu_supports("bmi");
+}
+
+bool has_bmi2() { return has_avx2() && __builtin_cpu_supports("bmi2"); }
+
+bool has_avx512() {
+    return has_bmi2() && __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+}
+
+bool has_vnni512() {
+    return has_avx512() && __builtin_cpu_supports("avx512vnni")
+        && __builtin_cpu_supports("avx512dq") && __builtin_cpu_supports("avx512vl");
+}
+
+// Ordered from the fastest to the most portable
+const Candidate Candidates[] = {{"x86-64-vnni512", has_vnni512},
+                                {"x86-64-avx512", has_avx512},
+                                {"x86-64-bmi2", [] { return has_bmi2() && !is_slow_pext_cpu(); }},
+                                {"x86-64-avx2", has_avx2},
+                                {"x86-64-sse41-popcnt", has_sse41_popcnt},
+                                {"x86-64", [] { return true; }}};
+
+std::string binary_directory(const char* argv0) {
+#ifdef __linux__
+    char    buf[4096];
+    ssize_t n = readlink("/proc/self/exe", buf, sizeof(buf) - 1);
+    std::string path = n > 0 ? std::string(buf, size_t(n)) : std::string(argv0);
+#else
+    std::string path = argv0;
+#endif
+    size_t pos = path.find_last_of("/\\");
+    return pos == std::string::npos ? "./" : path.substr(0, pos + 1);
+}
+
+#ifdef _WIN32
+// _spawnv() joins the arguments with spaces into a single command line, which
+// the child splits again. Quote each argument following the rules of the C
+// runtime parser, so that file names with spaces survive.
+std::string quote_argument(const std::string& arg) {
+    if (!arg.empty() && arg.find_first_of(" \t\n\v\"") == std::string::npos)
+        return arg;
+
+    std::string quoted      = "\"";
+    size_t      backslashes = 0;
+
+    for (char c : arg)
+    {
+        if (c == '\\')
+        {
+            ++backslashes;
+            continue;
+        }
+
+        // Backslashes are literal unless they precede a quote
+        quoted.append(c == '"' ? 2 * backslashes + 1 : backslashes, '\\');
+        quoted.push_back(c);
+        backslashes = 0;
+    }
+
+    // Closing quote, escape the trailing backslashes
+    quoted.append(2 * backslashes, '\\');
+    quoted.push_back('"');
+
+    return quoted;
+}
+#endif
+
+bool file_exists(const std::string& path) {
+    if (FILE* f = std::fopen(path.c_str(), "rb"))
+    {
+        std::fclose(f);
+        return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+
+    __builtin_cpu_init();
+
+    const std::string dir = binary_directory(argv[0]);
+
+    for (const Candidate& c : Candidates)
+    {
+        std::string exe = dir + "judas-" + c.arch;
+#ifdef _WIN32
+        exe += ".exe";
+#endif
+        if (!c.supported() || !file_exists(exe))
+            continue;
+
+#ifdef _WIN32
+        std::vector<std::string> quoted{quote_argument(exe)};
+        for (int i = 1; i < argc; ++i)
+            quoted.push_back(quote_argument(argv[i]));
+
+        std::vector<const char*> args;
+        for (const std::string& arg : quoted)
+            args.push_back(arg.c_str());
+        args.push_back(nullptr);
+
+        _putenv_s("JUDAS_DISPATCH", c.arch);
+        return int(_spawnv(_P_WAIT, exe.c_str(), args.data()));
+#else
+        std::vector<char*> args(argv, argv + argc);
+        args[0] = exe.data();
+        args.push_back(nullptr);
+
+        setenv("JUDAS_DISPATCH", c.arch, 1);
+        execv(exe.c_str(), args.data());
+        std::perror(exe.c_str());
+        return EXIT_FAILURE;
+#endif
+    }
+
+    std::fprintf(stderr, "No judas-<arch> binary found for this CPU in %s\n", dir.c_str());
+    return EXIT_FAILURE;
+}
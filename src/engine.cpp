@@ -18,6 +18,7 @@
 
 #include "engine.h"
 
+#include <algorithm>
 #include <cassert>
 #include <deque>
 #include <iosfwd>
@@ -28,6 +29,7 @@
 #include <utility>
 #include <vector>
 
+#include "benchmark.h"
 #include "evaluate.h"
 #include "misc.h"
 #include "nnue/network.h"
@@ -81,6 +83,11 @@ Engine::Engine(std::optional<std::string> path) :
         return thread_allocation_information_as_string();
     });
 
+    options["Thread Spin Wait"] << Option(0, 0, 10000, [this](const Option& o) {
+        threads.set_spin_wait(o);
+        return std::nullopt;
+    });
+
     options["Hash"] << Option(16, 1, MaxHashMB, [this](const Option& o) {
         set_tt_size(o);
         return std::nullopt;
@@ -109,13 +116,22 @@ Engine::Engine(std::optional<std::string> path) :
     });
     options["Book Width"] << Option(1, 1, 20);
     options["Book Depth"] << Option(255, 1, 255);
-    options["SyzygyPath"] << Option("", [](const Option& o) {
-        Tablebases::init(o);
+    options["SyzygyPath"] << Option("", [this](const Option&) {
+        init_tablebases();
         return std::nullopt;
     });
     options["SyzygyProbeDepth"] << Option(1, 1, 100);
     options["Syzygy50MoveRule"] << Option(true);
     options["SyzygyProbeLimit"] << Option(7, 0, 7);
+    options["SyzygyPrefetch"] << Option(0, 0, 7, [this](const Option&) {
+        init_tablebases();
+        return std::nullopt;
+    });
+    options["SyzygyMadvise"] << Option("Random var Random var WillNeed", "Random",
+                                       [this](const Option&) {
+                                           init_tablebases();
+                                           return std::nullopt;
+                                       });
 
     options["Select Style"] << Option(
         "Default var Default var Aggressive var Defensive var Positional", "Default", // Default value
@@ -212,10 +228,48 @@ options["Experience Book Logging"] << Option(false, [](const Option& opt) {
     resize_threads();
 }
 
-std::uint64_t Engine::perft(const std::string& fen, Depth depth, bool isChess960) {
+Engine::~Engine() { wait_for_search_finished(); }
+
+void Engine::run_parallel(size_t count, const std::function<void(size_t)>& job) {
+    wait_for_search_finished();
+    threads.run_parallel(count, job);
+}
+
+std::uint64_t
+Engine::perft(const std::string& fen, Depth depth, bool isChess960, size_t hashMB) {
+    wait_for_search_finished();
     verify_networks();
 
-    return Benchmark::perft(fen, depth, isChess960);
+    return Benchmark::perft(threads, fen, depth, isChess960,
+                            depth > 2 ? perft_table(hashMB) : nullptr);
+}
+
+void Engine::perft_batch(const std::vector<std::pair<std::string, Depth>>& jobs,
+                         bool                                              isChess960,
+                         size_t                                            hashMB,
+                         std::function<void(size_t, std::uint64_t)>       onResult) {
+    wait_for_search_finished();
+    verify_networks();
+
+    Benchmark::PerftTable* table = perft_table(hashMB);
+
+    for (size_t i = 0; i < jobs.size(); ++i)
+        onResult(i, Benchmark::perft(threads, jobs[i].first, jobs[i].second, isChess960, table,
+                                     false));
+}
+
+// Subtree counts do not depend on the root, so the table is kept between
+// perft calls and only reallocated when the requested size changes. A size
+// of 0 frees it and runs without one.
+Benchmark::PerftTable* Engine::perft_table(size_t mbSize) {
+    if (mbSize != perftHashMB)
+    {
+        perftTable.reset();
+        perftTable  = mbSize ? std::make_unique<Benchmark::PerftTable>(mbSize) : nullptr;
+        perftHashMB = mbSize;
+    }
+
+    return perftTable.get();
 }
 
 void Engine::go(Search::LimitsType& limits) {
@@ -226,14 +280,41 @@ void Engine::go(Search::LimitsType& limits) {
 }
 void Engine::stop() { threads.stop = true; }
 
+void Engine::analyse_batch(std::vector<std::string>                fens,
+                           const Search::LimitsType&               limits,
+                           std::function<void(const InfoBatch&)>&& onResult,
+                           std::function<void()>&&                 onDone) {
+    verify_networks();
+    wait_for_search_finished();
+
+    tt.new_search();
+    threads.analyse_batch(std::move(fens), limits, onResult, onDone);
+}
+
 void Engine::search_clear() {
     wait_for_search_finished();
 
     tt.clear(threads);
     threads.clear();
+}
+
+// Re-initializing unmaps every table and restarts the warm-up, so it is only
+// done when the settings change, not when a GUI sends the same ones again.
+void Engine::init_tablebases() {
+    const std::string path     = options["SyzygyPath"];
+    const int         warmUp   = options["SyzygyPrefetch"];
+    const bool        willNeed = options["SyzygyMadvise"] == "WillNeed";
+
+    const std::string settings = path + '\n' + std::to_string(warmUp) + '\n' + char('0' + willNeed);
+
+    if (settings == tablebaseSettings)
+        return;
+
+    tablebaseSettings = settings;
 
     // @TODO wont work with multiple instances
-    Tablebases::init(options["SyzygyPath"]);  // Free mapped files
+    Tablebases::init(path, warmUp,
+                     willNeed ? Tablebases::MapAdvice::WillNeed : Tablebases::MapAdvice::Random);
 }
 
 void Engine::set_on_update_no_moves(std::function<void(const Engine::InfoShort&)>&& f) {
@@ -398,6 +479,54 @@ void Engine::trace_eval() const {
     sync_cout << "\n" << Eval::trace(p, *networks) << sync_endl;
 }
 
+std::string Engine::nnue_benchmark(int passes) const {
+    verify_networks();
+
+    return Eval::NNUE::benchmark(*networks, Benchmark::benchmark_games(), passes);
+}
+
+void Engine::evaluate_batch(
+  const std::vector<std::string>&                                fens,
+  const std::function<void(size_t, const std::optional<Score>&)>& onResult) const {
+
+    constexpr size_t ChunkSize = 1024;
+
+    verify_networks();
+
+    auto caches = std::make_unique<Eval::NNUE::AccumulatorCaches>(*networks);
+
+    for (size_t first = 0; first < fens.size(); first += ChunkSize)
+    {
+        const size_t count = std::min(ChunkSize, fens.size() - first);
+
+        std::deque<StateInfo>        batchStates(count);
+        std::vector<Position>        positions(count);
+        std::vector<const Position*> batch;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            positions[i].set(fens[first + i], options["UCI_Chess960"], &batchStates[i]);
+            if (!positions[i].checkers())
+                batch.push_back(&positions[i]);
+        }
+
+        auto values = Eval::evaluate_batch(*networks, batch, *caches, VALUE_ZERO);
+
+        for (size_t i = 0, j = 0; i < count; ++i)
+        {
+            if (positions[i].checkers())
+            {
+                onResult(first + i, std::nullopt);
+                continue;
+            }
+
+            Value v = positions[i].side_to_move() == WHITE ? values[j] : -values[j];
+            onResult(first + i, Score(v, positions[i]));
+            ++j;
+        }
+    }
+}
+
 const OptionsMap& Engine::get_options() const { return options; }
 OptionsMap&       Engine::get_options() { return options; }
 
@@ -456,11 +585,27 @@ std::string Engine::thread_binding_information_as_string() const {
     return ss.str();
 }
 
+// Time each helper thread took to start its last search after the main thread
+std::vector<std::chrono::steady_clock::duration> Engine::helper_wakeup_latencies() const {
+    return threads.helper_wakeup_latencies();
+}
+
+// Search step counters summed over all threads since the last 'ucinewgame'.
+// Empty unless compiled with SEARCH_STATS.
+std::string Engine::search_stats_as_string() const {
+#ifdef SEARCH_STATS
+    return Search::to_string(threads.search_stats());
+#else
+    return "";
+#endif
+}
+
 std::string Engine::thread_allocation_information_as_string() const {
     std::stringstream ss;
 
     size_t threadsSize = threads.size();
     ss << "Using " << threadsSize << (threadsSize > 1 ? " threads" : " thread");
+    ss << " (" << (sizeof(Search::Worker) >> 20) << "MiB of search tables per thread)";
 
     auto boundThreadsByNodeStr = thread_binding_information_as_string();
     if (boundThreadsByNodeStr.empty())
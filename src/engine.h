@@ -22,6 +22,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
@@ -39,6 +40,10 @@
 
 namespace Judas {
 
+namespace Benchmark {
+class PerftTable;
+}
+
 // Enumeration for game styles
 enum GameStyle { Default, Aggressive, Defensive, Positional };
 
@@ -50,6 +55,7 @@ class Engine {
     using InfoShort = Search::InfoShort;
     using InfoFull  = Search::InfoFull;
     using InfoIter  = Search::InfoIteration;
+    using InfoBatch = Search::InfoBatch;
 
     Engine(std::optional<std::string> path = std::nullopt);
 
@@ -59,15 +65,31 @@ class Engine {
     Engine& operator=(const Engine&) = delete;
     Engine& operator=(Engine&&)      = delete;
 
-    ~Engine() { wait_for_search_finished(); }
+    ~Engine();
+
+    // blocking call, runs the jobs numbered 0 to count - 1 on the search threads
+    void run_parallel(size_t count, const std::function<void(size_t)>& job);
 
-    std::uint64_t perft(const std::string& fen, Depth depth, bool isChess960);
+    // blocking calls, split the root moves across the threads, which share a
+    // perft table of hashMB megabytes kept across calls, none if 0
+    std::uint64_t perft(const std::string& fen, Depth depth, bool isChess960, size_t hashMB);
+    void          perft_batch(const std::vector<std::pair<std::string, Depth>>& jobs,
+                              bool                                              isChess960,
+                              size_t                                            hashMB,
+                              std::function<void(size_t, std::uint64_t)>       onResult);
 
     // non blocking call to start searching
     void go(Search::LimitsType&);
     // non blocking call to stop searching
     void stop();
 
+    // non blocking call, searches each position on a single thread, reports
+    // every result as soon as it is available and calls onDone at the end
+    void analyse_batch(std::vector<std::string> fens,
+                       const Search::LimitsType&,
+                       std::function<void(const InfoBatch&)>&&,
+                       std::function<void()>&& onDone);
+
     // blocking call to wait for search to finish
     void wait_for_search_finished();
     // set a new position, moves are in UCI format
@@ -78,6 +100,7 @@ class Engine {
     void set_numa_config_from_option(const std::string& o);
     void resize_threads();
     void init_bookMan(int bookIndex);
+    void init_tablebases();
     void set_tt_size(size_t mb);
     void set_ponderhit(bool);
     void search_clear();
@@ -99,6 +122,12 @@ class Engine {
     // utility functions
 
     void trace_eval() const;
+    // times each stage of the evaluation over the benchmark games
+    std::string nnue_benchmark(int passes) const;
+    // static evaluation of each position from white's point of view, batched
+    // through the networks; positions in check are reported without a score
+    void evaluate_batch(const std::vector<std::string>&                            fens,
+                        const std::function<void(size_t, const std::optional<Score>&)>& onResult) const;
 
     const OptionsMap& get_options() const;
     OptionsMap&       get_options();
@@ -114,8 +143,12 @@ class Engine {
     std::string                            numa_config_information_as_string() const;
     std::string                            thread_allocation_information_as_string() const;
     std::string                            thread_binding_information_as_string() const;
+    std::string                            search_stats_as_string() const;
+    std::vector<std::chrono::steady_clock::duration> helper_wakeup_latencies() const;
     Position                               pos;
    private:
+    Benchmark::PerftTable* perft_table(size_t mbSize);
+
     const std::string binaryDirectory;
 
     NumaReplicationContext numaContext;
@@ -127,6 +160,9 @@ class Engine {
     TranspositionTable                       tt;
     LazyNumaReplicated<Eval::NNUE::Networks> networks;
     BookManager                              bookMan;
+    std::string                              tablebaseSettings;
+    std::unique_ptr<Benchmark::PerftTable>   perftTable;
+    size_t                                   perftHashMB = 0;
     Search::SearchManager::UpdateContext  updateContext;
     std::function<void(std::string_view)> onVerifyNetworks;
 };
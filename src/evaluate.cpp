@@ -27,6 +27,7 @@
 #include <memory>
 #include <sstream>
 #include <tuple>
+#include <vector>
 
 #include "nnue/network.h"
 #include "nnue/nnue_misc.h"
@@ -37,47 +38,119 @@
 
 namespace Judas {
 
+namespace {
+
+// Squares within distance 2 of the given square
+Bitboard distance_two_zone(Square s) {
+    Bitboard b = square_bb(s);
+    b |= shift<EAST>(b) | shift<WEST>(b);
+    b |= shift<EAST>(b) | shift<WEST>(b);
+    b |= shift<NORTH>(b) | shift<SOUTH>(b);
+    b |= shift<NORTH>(b) | shift<SOUTH>(b);
+    return b;
+}
+
+// Pawns without a friendly pawn on an adjacent file
+Bitboard isolated_pawns(Bitboard pawns) {
+    Bitboard files = pawns;
+    files |= files >> 8, files |= files >> 16, files |= files >> 32;
+    files = (files & Rank1BB) * FileABB;
+    return pawns & ~(shift<EAST>(files) | shift<WEST>(files));
+}
+
+int knights_near_enemy_king(const Position& pos) {
+    Color us = pos.side_to_move();
+    return popcount(pos.pieces(us, KNIGHT) & distance_two_zone(pos.square<KING>(~us)));
+}
+
+int isolated_pawn_count(const Position& pos) {
+    return popcount(isolated_pawns(pos.pieces(pos.side_to_move(), PAWN)));
+}
+
+// The style term added to the network output, specialized per style. The
+// weights are the sums of the per-style helpers and the extra per-style bonuses
+// they used to be combined with.
+template<GameStyle S>
+int style_bonus(const Position& pos) {
+
+    Color us = pos.side_to_move();
+
+    if constexpr (S == Aggressive)
+    {
+        constexpr Bitboard Advanced[COLOR_NB] = {Rank5BB | Rank6BB | Rank7BB | Rank8BB,
+                                                 Rank4BB | Rank3BB | Rank2BB | Rank1BB};
+
+        return 40 * knights_near_enemy_king(pos)
+             + 10 * popcount(pos.pieces(us, PAWN) & Advanced[us]);
+    }
+    else if constexpr (S == Defensive)
+        return -20 * knights_near_enemy_king(pos) - 30 * isolated_pawn_count(pos)
+             + (pos.can_castle(ANY_CASTLING) ? 80 : 0);
+
+    else if constexpr (S == Positional)
+        return 2 * Eval::calculate_positional_bonus(pos);
+
+    else
+        return 0;
+}
+
+// The network output adjusted by the selected style
+Value styled_nnue(const Position& pos, Value psqt, Value positional) {
+
+    Value nnue = (125 * psqt + 131 * positional) / 128;
+
+    switch (style)
+    {
+    case Aggressive :
+        return nnue + style_bonus<Aggressive>(pos);
+    case Defensive :
+        return nnue + style_bonus<Defensive>(pos);
+    case Positional :
+        return nnue + style_bonus<Positional>(pos);
+    default :
+        return nnue;
+    }
+}
+
+// Re-evaluate the position with the big net when higher eval accuracy is worth
+// the time spent
+bool needs_big_net(Value nnue) { return std::abs(nnue) < 236; }
+
+Value final_eval(
+  const Position& pos, Value psqt, Value positional, Value nnue, bool smallNet, int optimism) {
+
+    // Blend optimism and eval with nnue complexity
+    int nnueComplexity = std::abs(psqt - positional);
+    optimism += optimism * nnueComplexity / 468;
+    nnue -= nnue * nnueComplexity / (smallNet ? 20233 : 17879);
+
+    int material = (smallNet ? 553 : 532) * pos.count<PAWN>() + pos.non_pawn_material();
+    int v        = (nnue * (77777 + material) + optimism * (7777 + material)) / 77777;
+
+    // Damp down the evaluation linearly when shuffling
+    v -= v * pos.rule50_count() / 212;
+
+    // Guarantee evaluation does not hit the tablebase range
+    return std::clamp(v, VALUE_TB_LOSS_IN_MAX_PLY + 1, VALUE_TB_WIN_IN_MAX_PLY - 1);
+}
+
+}  // namespace
+
 // Aggressive style: bonus for knights near the enemy king
 int Eval::calculate_aggressiveness_bonus(const Position& pos) {
-    int bonus = 0;
-    for (Square s = SQ_A1; s <= SQ_H8; ++s) {
-        if (pos.piece_on(s) == make_piece(pos.side_to_move(), KNIGHT) &&
-            pos.is_near_enemy_king(s)) {
-            bonus += 20;  // Bonus
-        }
-    }
-    return bonus;
+    return 20 * knights_near_enemy_king(pos);
 }
 
 // Defensive style: penalty for isolated pawns and bonus for castling
 int Eval::calculate_defensiveness_bonus(const Position& pos) {
-    int penalty = 0;
-    Bitboard pawns = pos.pieces(pos.side_to_move(), PAWN);
-    for (Square s = SQ_A1; s <= SQ_H8; ++s) {
-        if (pos.piece_on(s) == make_piece(pos.side_to_move(), PAWN) &&
-            pos.is_isolated(s, pawns)) {
-            penalty -= 15;  // Penalità pedoni isolati
-        }
-    }
-    if (pos.can_castle(CastlingRights(CastlingRights::KING_SIDE | CastlingRights::QUEEN_SIDE))) {
-        penalty += 40;  // Bonus arrocco
-    }
-    return penalty;
+    return -15 * isolated_pawn_count(pos) + (pos.can_castle(ANY_CASTLING) ? 40 : 0);
 }
 
-// Positional style: bonus for bishop pairs and rooks on the seventh rank
+// Positional style: bonus for bishops and rooks on the seventh rank
 int Eval::calculate_positional_bonus(const Position& pos) {
-    int bonus = 0;
-    for (Square s = SQ_A1; s <= SQ_H8; ++s) {
-        if (pos.piece_on(s) == make_piece(pos.side_to_move(), BISHOP)) {
-            bonus += 10;  // Bonus for the bishop pair
-        }
-        if (pos.piece_on(s) == make_piece(pos.side_to_move(), ROOK) &&
-            pos.is_on_seventh_rank(s, pos.side_to_move())) {
-            bonus += 15;  // Bonus for rooks on the seventh rank
-        }
-    }
-    return bonus;
+    Color us = pos.side_to_move();
+    return 10 * pos.count<BISHOP>(us)
+         + 15 * popcount(pos.pieces(us, ROOK) & (us == WHITE ? Rank7BB : Rank2BB));
 }
 
 // Returns a static, purely materialistic evaluation of the position from
@@ -97,84 +170,87 @@ bool Eval::use_smallnet(const Position& pos) {
 // of the position from the point of view of the side to move.
 Value Eval::evaluate(const Eval::NNUE::Networks&    networks,
                      const Position&                pos,
+                     Eval::NNUE::AccumulatorStack&  accumulators,
                      Eval::NNUE::AccumulatorCaches& caches,
                      int                            optimism) {
 
     assert(!pos.checkers());
 
     bool smallNet           = use_smallnet(pos);
-    auto [psqt, positional] = smallNet ? networks.small.evaluate(pos, &caches.small)
-                                       : networks.big.evaluate(pos, &caches.big);
-
-Value nnue = (125 * psqt + 131 * positional) / 128;
+    auto [psqt, positional] = smallNet ? networks.small.evaluate(pos, accumulators, &caches.small)
+                                       : networks.big.evaluate(pos, accumulators, &caches.big);
 
-// Evaluation adjustment based on style
-if (style == Aggressive) {
-    nnue += Eval::calculate_aggressiveness_bonus(pos);
+    Value nnue = styled_nnue(pos, psqt, positional);
 
-    // Adds specific bonuses for the aggressive style
-    for (Square s = SQ_A1; s <= SQ_H8; ++s) {
-        if (pos.piece_on(s) == make_piece(pos.side_to_move(), KNIGHT) && pos.is_near_enemy_king(s)) {
-            nnue += 20; // Bonus for knights near the enemy king
-        }
-        if (pos.piece_on(s) == make_piece(pos.side_to_move(), PAWN) &&
-            relative_rank(pos.side_to_move(), s) >= RANK_5) {
-            nnue += 10; // Bonus for advanced pawns
-        }
-    }
-} else if (style == Defensive) {
-    nnue -= Eval::calculate_aggressiveness_bonus(pos);
-    nnue += Eval::calculate_defensiveness_bonus(pos);
-
-    // Penalizes isolated pawns
-    Bitboard pawnSet = pos.pieces(pos.side_to_move(), PAWN);
-    for (Square s = SQ_A1; s <= SQ_H8; ++s) {
-        if (pos.piece_on(s) == make_piece(pos.side_to_move(), PAWN) && pos.is_isolated(s, pawnSet)) {
-            nnue -= 15; // Penalty for isolated pawns
-        }
-    }
-
-    // Bonus for castling
-    if (pos.can_castle(CastlingRights(CastlingRights::KING_SIDE | CastlingRights::QUEEN_SIDE))) {
-        nnue += 40;
-    }
-} else if (style == Positional) {
-    nnue += Eval::calculate_positional_bonus(pos);
-
-    // Adds specific bonuses for the positional style
-    for (Square s = SQ_A1; s <= SQ_H8; ++s) {
-        if (pos.piece_on(s) == make_piece(pos.side_to_move(), BISHOP)) {
-            nnue += 10; // Bonus for the bishop pair
-        }
-        if (pos.piece_on(s) == make_piece(pos.side_to_move(), ROOK) &&
-            pos.is_on_seventh_rank(s, pos.side_to_move())) {
-            nnue += 15; // Bonus for rooks on the seventh rank
-        }
-    }
-}
-    // Re-evaluate the position when higher eval accuracy is worth the time spent
-    if (smallNet && (std::abs(nnue) < 236))
+    if (smallNet && needs_big_net(nnue))
     {
-        std::tie(psqt, positional) = networks.big.evaluate(pos, &caches.big);
+        std::tie(psqt, positional) = networks.big.evaluate(pos, accumulators, &caches.big);
         nnue                       = (125 * psqt + 131 * positional) / 128;
         smallNet                   = false;
     }
 
-    // Blend optimism and eval with nnue complexity
-    int nnueComplexity = std::abs(psqt - positional);
-    optimism += optimism * nnueComplexity / 468;
-    nnue -= nnue * nnueComplexity / (smallNet ? 20233 : 17879);
+    return final_eval(pos, psqt, positional, nnue, smallNet, optimism);
+}
 
-    int material = (smallNet ? 553 : 532) * pos.count<PAWN>() + pos.non_pawn_material();
-    int v        = (nnue * (77777 + material) + optimism * (7777 + material)) / 77777;
+// Same as evaluate() for many positions, none of them in check, with their
+// network passes batched. Used by offline tools.
+std::vector<Value> Eval::evaluate_batch(const Eval::NNUE::Networks&         networks,
+                                        const std::vector<const Position*>& positions,
+                                        Eval::NNUE::AccumulatorCaches&      caches,
+                                        int                                 optimism) {
 
-    // Damp down the evaluation linearly when shuffling
-    v -= v * pos.rule50_count() / 212;
+    const size_t count = positions.size();
 
-    // Guarantee evaluation does not hit the tablebase range
-    v = std::clamp(v, VALUE_TB_LOSS_IN_MAX_PLY + 1, VALUE_TB_WIN_IN_MAX_PLY - 1);
+    std::vector<NNUE::NetworkOutput> output(count);
+    std::vector<bool>                smallNet(count), reevaluated(count);
+    std::vector<size_t>              bigIdx, smallIdx;
+    std::vector<const Position*>     bigBatch, smallBatch;
+
+    auto accumulators = std::make_unique<NNUE::AccumulatorStack>();
+
+    auto run_batch = [&](auto& net, auto* cache, std::vector<size_t>& idx,
+                         std::vector<const Position*>& batch) {
+        auto netOutput = net.evaluate_batch(batch, *accumulators, cache);
+        for (size_t i = 0; i < idx.size(); ++i)
+            output[idx[i]] = netOutput[i];
+        idx.clear();
+        batch.clear();
+    };
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        assert(!positions[i]->checkers());
+
+        smallNet[i] = use_smallnet(*positions[i]);
+        (smallNet[i] ? smallIdx : bigIdx).push_back(i);
+        (smallNet[i] ? smallBatch : bigBatch).push_back(positions[i]);
+    }
+
+    run_batch(networks.small, &caches.small, smallIdx, smallBatch);
+
+    // Small net results that need the big net join the big batch
+    for (size_t i = 0; i < count; ++i)
+        if (smallNet[i]
+            && needs_big_net(styled_nnue(*positions[i], std::get<0>(output[i]),
+                                         std::get<1>(output[i]))))
+        {
+            smallNet[i] = false, reevaluated[i] = true;
+            bigIdx.push_back(i);
+            bigBatch.push_back(positions[i]);
+        }
+
+    run_batch(networks.big, &caches.big, bigIdx, bigBatch);
+
+    std::vector<Value> values(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        auto [psqt, positional] = output[i];
+        Value nnue              = reevaluated[i] ? (125 * psqt + 131 * positional) / 128
+                                                 : styled_nnue(*positions[i], psqt, positional);
+        values[i] = final_eval(*positions[i], psqt, positional, nnue, smallNet[i], optimism);
+    }
 
-    return v;
+    return values;
 }
 
 // Like evaluate(), but instead of returning a value, it returns
@@ -186,20 +262,23 @@ std::string Eval::trace(Position& pos, const Eval::NNUE::Networks& networks) {
     if (pos.checkers())
         return "Final evaluation: none (in check)";
 
-    auto caches = std::make_unique<Eval::NNUE::AccumulatorCaches>(networks);
+    auto accumulators = std::make_unique<Eval::NNUE::AccumulatorStack>();
+    auto caches       = std::make_unique<Eval::NNUE::AccumulatorCaches>(networks);
 
     std::stringstream ss;
     ss << std::showpoint << std::noshowpos << std::fixed << std::setprecision(2);
-    ss << '\n' << NNUE::trace(pos, networks, *caches) << '\n';
+    ss << '\n' << NNUE::trace(pos, networks, *accumulators, *caches) << '\n';
 
     ss << std::showpoint << std::showpos << std::fixed << std::setprecision(2) << std::setw(15);
 
-    auto [psqt, positional] = networks.big.evaluate(pos, &caches->big);
+    accumulators->reset();
+    auto [psqt, positional] = networks.big.evaluate(pos, *accumulators, &caches->big);
     Value v                 = psqt + positional;
     v                       = pos.side_to_move() == WHITE ? v : -v;
     ss << "NNUE evaluation        " << 0.01 * UCIEngine::to_cp(v, pos) << " (white side)\n";
 
-    v = evaluate(networks, pos, *caches, VALUE_ZERO);
+    accumulators->reset();
+    v = evaluate(networks, pos, *accumulators, *caches, VALUE_ZERO);
     v = pos.side_to_move() == WHITE ? v : -v;
     ss << "Final evaluation       " << 0.01 * UCIEngine::to_cp(v, pos) << " (white side)";
     ss << " [with scaled NNUE, ...]";
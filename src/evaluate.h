@@ -20,6 +20,7 @@
 #define EVALUATE_H_INCLUDED
 
 #include <string>
+#include <vector>
 
 #include "types.h"
 
@@ -44,6 +45,7 @@ int calculate_positional_bonus(const Position& pos);
 namespace NNUE {
 struct Networks;
 struct AccumulatorCaches;
+class AccumulatorStack;
 }
 
 std::string trace(Position& pos, const Eval::NNUE::Networks& networks);
@@ -52,8 +54,14 @@ int   simple_eval(const Position& pos, Color c);
 bool  use_smallnet(const Position& pos);
 Value evaluate(const NNUE::Networks&          networks,
                const Position&                pos,
+               Eval::NNUE::AccumulatorStack&  accumulators,
                Eval::NNUE::AccumulatorCaches& caches,
                int                            optimism);
+
+std::vector<Value> evaluate_batch(const NNUE::Networks&               networks,
+                                  const std::vector<const Position*>& positions,
+                                  Eval::NNUE::AccumulatorCaches&      caches,
+                                  int                                 optimism);
 }  // namespace Eval
 
 }  // namespace Judas
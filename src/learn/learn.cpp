@@ -359,6 +359,7 @@ for (auto& [key, learning_move] : HT) {
 needPersisting = true; // Segnala che i dati devono essere salvati
 std::cout << "Finished updating performances and quality. Total processed entries: " 
           << entry_count << std::endl;
+}
 
 void LearningData::set_learning_mode(Judas::OptionsMap& options, const string& lm) {
     LearningMode newLearningMode = identify_learning_mode(lm);
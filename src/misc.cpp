@@ -269,6 +269,13 @@ std::string compiler_info() {
     compiler += " DEBUG";
 #endif
 
+    // Set by the launcher of a dispatch build to the architecture it selected
+    if (const char* dispatched = std::getenv("JUDAS_DISPATCH"))
+    {
+        compiler += "\nRuntime dispatch           : ";
+        compiler += dispatched;
+    }
+
     compiler += "\nCompiler __VERSION__ macro : ";
 #ifdef __VERSION__
     compiler += __VERSION__;
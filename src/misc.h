@@ -145,10 +145,23 @@ class ValueList {
 
    public:
     std::size_t size() const { return size_; }
-    void        push_back(const T& value) { values_[size_++] = value; }
-    const T*    begin() const { return values_; }
-    const T*    end() const { return values_ + size_; }
-    const T&    operator[](int index) const { return values_[index]; }
+    bool        empty() const { return size_ == 0; }
+    bool        full() const { return size_ == MaxSize; }
+    void        clear() { size_ = 0; }
+    void        resize(std::size_t newSize) {
+        assert(newSize <= size_);
+        size_ = newSize;
+    }
+    void push_back(const T& value) {
+        assert(size_ < MaxSize);
+        values_[size_++] = value;
+    }
+    const T* begin() const { return values_; }
+    const T* end() const { return values_ + size_; }
+    T*       begin() { return values_; }
+    T*       end() { return values_ + size_; }
+    const T& operator[](int index) const { return values_[index]; }
+    T&       operator[](int index) { return values_[index]; }
 
    private:
     T           values_[MaxSize];
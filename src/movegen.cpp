@@ -203,6 +203,151 @@ ExtMove* generate_all(const Position& pos, ExtMove* moveList) {
     return moveList;
 }
 
+
+// Generates the legal moves directly, in the same order generate_all() emits
+// them. Pinned pieces are kept on the line through their king and the pinner,
+// so that only king steps, castling and en passant captures need a legality
+// test each. With CountOnly the moves are
+// counted, by popcount whenever possible, and nothing is written.
+template<Color Us, bool CountOnly>
+size_t generate_legal(const Position& pos, [[maybe_unused]] ExtMove* moveList) {
+
+    constexpr Color     Them     = ~Us;
+    constexpr Bitboard  TRank7BB = (Us == WHITE ? Rank7BB : Rank2BB);
+    constexpr Bitboard  TRank3BB = (Us == WHITE ? Rank3BB : Rank6BB);
+    constexpr Direction Up       = pawn_push(Us);
+    constexpr Direction UpRight  = (Us == WHITE ? NORTH_EAST : SOUTH_WEST);
+    constexpr Direction UpLeft   = (Us == WHITE ? NORTH_WEST : SOUTH_EAST);
+
+    const Square   ksq      = pos.square<KING>(Us);
+    const Bitboard checkers = pos.checkers();
+    const Bitboard pinned   = pos.blockers_for_king(Us) & pos.pieces(Us);
+    size_t         count    = 0;
+
+    const auto add = [&](Move m) {
+        if constexpr (CountOnly)
+            ++count;
+        else
+            moveList[count++] = m;
+    };
+
+    const auto add_moves = [&](Square from, Bitboard b) {
+        if constexpr (CountOnly)
+            count += popcount(b);
+        else
+            while (b)
+                moveList[count++] = Move(from, pop_lsb(b));
+    };
+
+    const auto add_pawn_moves = [&](Bitboard b, Direction d) {
+        if constexpr (CountOnly)
+            count += popcount(b);
+        else
+            while (b)
+            {
+                Square to         = pop_lsb(b);
+                moveList[count++] = Move(to - d, to);
+            }
+    };
+
+    const auto add_promotions = [&](Bitboard b, Direction d) {
+        if constexpr (CountOnly)
+            count += 4 * popcount(b);
+        else
+            while (b)
+            {
+                Square to = pop_lsb(b);
+                for (PieceType pt : {QUEEN, ROOK, BISHOP, KNIGHT})
+                    moveList[count++] = Move::make<PROMOTION>(to - d, to, pt);
+            }
+    };
+
+    // Skip generating non-king moves when in double check
+    if (!more_than_one(checkers))
+    {
+        const Bitboard target  = checkers ? between_bb(ksq, lsb(checkers)) : ~pos.pieces(Us);
+        const Bitboard enemies = checkers ? checkers : pos.pieces(Them);
+        const Bitboard empty   = ~pos.pieces();
+        const Bitboard pawns   = pos.pieces(Us, PAWN);
+
+        // A pawn pinned on the king file can still push, one pinned on a
+        // diagonal can still capture along it.
+        Bitboard pushers     = pawns & (~pinned | file_bb(ksq));
+        Bitboard rightTakers = pawns & ~pinned;
+        Bitboard leftTakers  = pawns & ~pinned;
+
+        for (Bitboard b = pawns & pinned; b;)
+        {
+            Square s = pop_lsb(b);
+            if (shift<UpRight>(square_bb(s)) & line_bb(ksq, s))
+                rightTakers |= s;
+            if (shift<UpLeft>(square_bb(s)) & line_bb(ksq, s))
+                leftTakers |= s;
+        }
+
+        Bitboard b1 = shift<Up>(pushers & ~TRank7BB) & empty;
+        Bitboard b2 = shift<Up>(b1 & TRank3BB) & empty;
+
+        if (checkers)  // Consider only blocking squares
+        {
+            b1 &= target;
+            b2 &= target;
+        }
+
+        add_pawn_moves(b1, Up);
+        add_pawn_moves(b2, Up + Up);
+
+        if (pawns & TRank7BB)
+        {
+            add_promotions(shift<UpRight>(rightTakers & TRank7BB) & enemies, UpRight);
+            add_promotions(shift<UpLeft>(leftTakers & TRank7BB) & enemies, UpLeft);
+            add_promotions(shift<Up>(pushers & TRank7BB) & empty & target, Up);
+        }
+
+        add_pawn_moves(shift<UpRight>(rightTakers & ~TRank7BB) & enemies, UpRight);
+        add_pawn_moves(shift<UpLeft>(leftTakers & ~TRank7BB) & enemies, UpLeft);
+
+        // En passant captures are rare and tricky, so they are fully tested.
+        // An en passant capture cannot resolve a discovered check.
+        if (pos.ep_square() != SQ_NONE && !(checkers && (target & (pos.ep_square() + Up))))
+            for (Bitboard b = pos.pieces(Us, PAWN) & ~TRank7BB
+                            & pawn_attacks_bb(Them, pos.ep_square());
+                 b;)
+            {
+                Move m = Move::make<EN_PASSANT>(pop_lsb(b), pos.ep_square());
+                if (pos.legal(m))
+                    add(m);
+            }
+
+        for (PieceType pt : {KNIGHT, BISHOP, ROOK, QUEEN})
+            for (Bitboard bb = pos.pieces(Us, pt); bb;)
+            {
+                Square   from = pop_lsb(bb);
+                Bitboard b    = attacks_bb(pt, from, pos.pieces()) & target;
+
+                add_moves(from, pinned & from ? b & line_bb(ksq, from) : b);
+            }
+    }
+
+    for (Bitboard b = attacks_bb<KING>(ksq) & ~pos.pieces(Us); b;)
+    {
+        Square to = pop_lsb(b);
+        if (!(pos.attackers_to(to, pos.pieces() ^ ksq) & pos.pieces(Them)))
+            add(Move(ksq, to));
+    }
+
+    if (!checkers && pos.can_castle(Us & ANY_CASTLING))
+        for (CastlingRights cr : {Us & KING_SIDE, Us & QUEEN_SIDE})
+            if (!pos.castling_impeded(cr) && pos.can_castle(cr))
+            {
+                Move m = Move::make<CASTLING>(ksq, pos.castling_rook_square(cr));
+                if (pos.legal(m))
+                    add(m);
+            }
+
+    return count;
+}
+
 }  // namespace
 
 
@@ -236,21 +381,16 @@ template ExtMove* generate<NON_EVASIONS>(const Position&, ExtMove*);
 template<>
 ExtMove* generate<LEGAL>(const Position& pos, ExtMove* moveList) {
 
-    Color    us     = pos.side_to_move();
-    Bitboard pinned = pos.blockers_for_king(us) & pos.pieces(us);
-    Square   ksq    = pos.square<KING>(us);
-    ExtMove* cur    = moveList;
-
-    moveList =
-      pos.checkers() ? generate<EVASIONS>(pos, moveList) : generate<NON_EVASIONS>(pos, moveList);
-    while (cur != moveList)
-        if (((pinned & cur->from_sq()) || cur->from_sq() == ksq || cur->type_of() == EN_PASSANT)
-            && !pos.legal(*cur))
-            *cur = *(--moveList);
-        else
-            ++cur;
+    return moveList
+         + (pos.side_to_move() == WHITE ? generate_legal<WHITE, false>(pos, moveList)
+                                        : generate_legal<BLACK, false>(pos, moveList));
+}
 
-    return moveList;
+// Returns the number of legal moves in the given position without generating them
+size_t count_legal(const Position& pos) {
+
+    return pos.side_to_move() == WHITE ? generate_legal<WHITE, true>(pos, nullptr)
+                                       : generate_legal<BLACK, true>(pos, nullptr);
 }
 
 }  // namespace Judas
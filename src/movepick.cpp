@@ -19,11 +19,17 @@
 #include "movepick.h"
 
 #include <cassert>
+#include <cstdint>
 #include <limits>
+#include <memory>
 
 #include "bitboard.h"
 #include "position.h"
 
+#if defined(USE_AVX2)
+    #include <immintrin.h>
+#endif
+
 namespace Judas {
 
 namespace {
@@ -54,6 +60,43 @@ enum Stages {
     QCAPTURE
 };
 
+#if defined(USE_AVX2)
+
+// Returns the start of a table of int16_t history entries
+template<typename T>
+const int16_t* history_data(const T& table) {
+    static_assert(sizeof(T) % (2 * sizeof(int16_t)) == 0, "Rows hold pairs of entries");
+    return reinterpret_cast<const int16_t*>(std::addressof(table));
+}
+
+// Gathers the entries of a history row at eight indices, sign extended. Each
+// lane loads the 32-bit pair of entries holding its own, counted from the start
+// of the row, so no lane reads past the end of the row as a 32-bit load at the
+// last entry itself would.
+inline __m256i gather_history(const int16_t* row, __m256i index) {
+    const __m256i pair =
+      _mm256_i32gather_epi32(reinterpret_cast<const int*>(row), _mm256_srli_epi32(index, 1), 4);
+    const __m256i shift = _mm256_slli_epi32(_mm256_andnot_si256(index, _mm256_set1_epi32(1)), 4);
+
+    return _mm256_srai_epi32(_mm256_sllv_epi32(pair, shift), 16);
+}
+
+// Returns all ones in the lanes whose square is set in the bitboard given by
+// its low and high halves, and zero in the others
+inline __m256i test_squares(__m256i lo, __m256i hi, __m256i sq) {
+    const __m256i thirtyOne = _mm256_set1_epi32(31);
+    const __m256i half      = _mm256_blendv_epi8(lo, hi, _mm256_cmpgt_epi32(sq, thirtyOne));
+    const __m256i up        = _mm256_sub_epi32(thirtyOne, _mm256_and_si256(sq, thirtyOne));
+
+    return _mm256_srai_epi32(_mm256_sllv_epi32(half, up), 31);
+}
+
+inline __m256i test_squares(Bitboard b, __m256i sq) {
+    return test_squares(_mm256_set1_epi32(int(b)), _mm256_set1_epi32(int(b >> 32)), sq);
+}
+
+#endif
+
 // Sort moves in descending order up to and including a given limit.
 // The order of moves smaller than the limit is left unspecified.
 void partial_insertion_sort(ExtMove* begin, ExtMove* end, int limit) {
@@ -124,74 +167,191 @@ void MovePicker::score() {
 
     static_assert(Type == CAPTURES || Type == QUIETS || Type == EVASIONS, "Wrong type");
 
-    [[maybe_unused]] Bitboard threatenedByPawn, threatenedByMinor, threatenedByRook,
-      threatenedPieces;
-    if constexpr (Type == QUIETS)
+    if constexpr (Type == CAPTURES)
+        for (auto& m : *this)
+            m.value =
+              7 * int(PieceValue[pos.piece_on(m.to_sq())])
+              + (*captureHistory)[pos.moved_piece(m)][m.to_sq()][type_of(pos.piece_on(m.to_sq()))];
+
+    else if constexpr (Type == QUIETS)
     {
         Color us = pos.side_to_move();
 
-        threatenedByPawn = pos.attacks_by<PAWN>(~us);
-        threatenedByMinor =
+        Bitboard threatenedByPawn = pos.attacks_by<PAWN>(~us);
+        Bitboard threatenedByMinor =
           pos.attacks_by<KNIGHT>(~us) | pos.attacks_by<BISHOP>(~us) | threatenedByPawn;
-        threatenedByRook = pos.attacks_by<ROOK>(~us) | threatenedByMinor;
+        Bitboard threatenedByRook = pos.attacks_by<ROOK>(~us) | threatenedByMinor;
 
         // Pieces threatened by pieces of lesser material value
-        threatenedPieces = (pos.pieces(us, QUEEN) & threatenedByRook)
-                         | (pos.pieces(us, ROOK) & threatenedByMinor)
-                         | (pos.pieces(us, KNIGHT, BISHOP) & threatenedByPawn);
-    }
+        Bitboard threatenedPieces = (pos.pieces(us, QUEEN) & threatenedByRook)
+                                  | (pos.pieces(us, ROOK) & threatenedByMinor)
+                                  | (pos.pieces(us, KNIGHT, BISHOP) & threatenedByPawn);
+
+        // The history rows only depend on the position, so resolve them once
+        // and keep the per-move work down to plain indexed loads.
+        const auto&           mainHist  = (*mainHistory)[us];
+        const auto&           pawnHist  = (*pawnHistory)[pawn_structure_index(pos)];
+        const PieceToHistory& contHist0 = *continuationHistory[0];
+        const PieceToHistory& contHist1 = *continuationHistory[1];
+        const PieceToHistory& contHist2 = *continuationHistory[2];
+        const PieceToHistory& contHist3 = *continuationHistory[3];
+        const PieceToHistory& contHist5 = *continuationHistory[5];
+
+        ExtMove* it = begin();
+
+#if defined(USE_AVX2)
+        // Eight moves at a time: the moves are split into from, to and piece
+        // lanes, the history entries are gathered and the threat terms are
+        // computed as lane masks. The rest of the list is scored below.
+        const int16_t* mainRow  = history_data(mainHist);
+        const int16_t* pawnRow  = history_data(pawnHist);
+        const int16_t* contRow0 = history_data(contHist0);
+        const int16_t* contRow1 = history_data(contHist1);
+        const int16_t* contRow2 = history_data(contHist2);
+        const int16_t* contRow3 = history_data(contHist3);
+        const int16_t* contRow5 = history_data(contHist5);
+
+        alignas(32) int checkLo[PIECE_TYPE_NB] = {}, checkHi[PIECE_TYPE_NB] = {};
+        for (PieceType pt = PAWN; pt <= KING; ++pt)
+        {
+            checkLo[pt] = int(pos.check_squares(pt));
+            checkHi[pt] = int(pos.check_squares(pt) >> 32);
+        }
 
-    for (auto& m : *this)
-        if constexpr (Type == CAPTURES)
-            m.value =
-              7 * int(PieceValue[pos.piece_on(m.to_sq())])
-              + (*captureHistory)[pos.moved_piece(m)][m.to_sq()][type_of(pos.piece_on(m.to_sq()))];
+        const __m256i checkLoV   = _mm256_load_si256(reinterpret_cast<const __m256i*>(checkLo));
+        const __m256i checkHiV   = _mm256_load_si256(reinterpret_cast<const __m256i*>(checkHi));
+        const __m256i sixtyThree = _mm256_set1_epi32(63);
+        const __m256i movesFirst = _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+
+        static_assert(sizeof(ExtMove) == 2 * sizeof(int), "A move word, then its value");
+
+        for (; end() - it >= 8; it += 8)
+        {
+            alignas(32) int pieces[8];
+            for (int k = 0; k < 8; ++k)
+                pieces[k] = pos.moved_piece(it[k]);
+
+            // Each ExtMove is a move word followed by its value
+            __m256i* ext   = reinterpret_cast<__m256i*>(it);
+            __m256i  lo    = _mm256_loadu_si256(ext);
+            __m256i  hi    = _mm256_loadu_si256(ext + 1);
+            __m256i  words = _mm256_permute2x128_si256(_mm256_permutevar8x32_epi32(lo, movesFirst),
+                                                       _mm256_permutevar8x32_epi32(hi, movesFirst),
+                                                       0x20);
+
+            __m256i fromTo = _mm256_and_si256(words, _mm256_set1_epi32(0xFFF));
+            __m256i from   = _mm256_and_si256(_mm256_srli_epi32(words, 6), sixtyThree);
+            __m256i to     = _mm256_and_si256(words, sixtyThree);
+            __m256i pc     = _mm256_load_si256(reinterpret_cast<const __m256i*>(pieces));
+            __m256i pt     = _mm256_and_si256(pc, _mm256_set1_epi32(7));
+            __m256i pcTo   = _mm256_add_epi32(_mm256_slli_epi32(pc, 6), to);
+
+            // histories
+            __m256i value = _mm256_add_epi32(gather_history(mainRow, fromTo),
+                                             gather_history(pawnRow, pcTo));
+            value         = _mm256_slli_epi32(value, 1);
+            value         = _mm256_add_epi32(value, gather_history(contRow0, pcTo));
+            value         = _mm256_add_epi32(value, gather_history(contRow1, pcTo));
+            value         = _mm256_add_epi32(value, gather_history(contRow2, pcTo));
+            value         = _mm256_add_epi32(value, gather_history(contRow3, pcTo));
+            value         = _mm256_add_epi32(value, gather_history(contRow5, pcTo));
+
+            // bonus for checks
+            __m256i check = test_squares(_mm256_permutevar8x32_epi32(checkLoV, pt),
+                                         _mm256_permutevar8x32_epi32(checkHiV, pt), to);
+            value = _mm256_add_epi32(value, _mm256_and_si256(check, _mm256_set1_epi32(16384)));
+
+            __m256i isQueen = _mm256_cmpeq_epi32(pt, _mm256_set1_epi32(QUEEN));
+            __m256i isRook  = _mm256_cmpeq_epi32(pt, _mm256_set1_epi32(ROOK));
+            __m256i toPawn  = test_squares(threatenedByPawn, to);
+            __m256i toMinor = test_squares(threatenedByMinor, to);
+            __m256i toRook  = test_squares(threatenedByRook, to);
+
+            // bonus for escaping from capture, blending the conditions of the
+            // scalar code from the last one to the first
+            __m256i escape = _mm256_andnot_si256(toPawn, _mm256_set1_epi32(14450));
+            escape         = _mm256_blendv_epi8(escape, _mm256_set1_epi32(25600),
+                                                _mm256_andnot_si256(toMinor, isRook));
+            escape         = _mm256_blendv_epi8(escape, _mm256_set1_epi32(51700),
+                                                _mm256_andnot_si256(toRook, isQueen));
+            escape         = _mm256_and_si256(test_squares(threatenedPieces, from), escape);
+            value          = _mm256_add_epi32(value, escape);
 
-        else if constexpr (Type == QUIETS)
+            // malus for putting piece en prise
+            __m256i queenMalus = _mm256_and_si256(_mm256_and_si256(isQueen, toRook),
+                                                  _mm256_set1_epi32(49000));
+            __m256i rookMalus  = _mm256_and_si256(_mm256_and_si256(isRook, toMinor),
+                                                  _mm256_set1_epi32(24335));
+            value = _mm256_sub_epi32(value, _mm256_or_si256(queenMalus, rookMalus));
+
+            // Put the values back after their moves
+            __m256i valuesLo =
+              _mm256_permutevar8x32_epi32(value, _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3));
+            __m256i valuesHi =
+              _mm256_permutevar8x32_epi32(value, _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7));
+
+            _mm256_storeu_si256(ext, _mm256_blend_epi32(lo, valuesLo, 0xAA));
+            _mm256_storeu_si256(ext + 1, _mm256_blend_epi32(hi, valuesHi, 0xAA));
+        }
+#endif
+
+        for (; it != end(); ++it)
         {
+            ExtMove&  m    = *it;
             Piece     pc   = pos.moved_piece(m);
             PieceType pt   = type_of(pc);
             Square    from = m.from_sq();
             Square    to   = m.to_sq();
 
             // histories
-            m.value = 2 * (*mainHistory)[pos.side_to_move()][m.from_to()];
-            m.value += 2 * (*pawnHistory)[pawn_structure_index(pos)][pc][to];
-            m.value += (*continuationHistory[0])[pc][to];
-            m.value += (*continuationHistory[1])[pc][to];
-            m.value += (*continuationHistory[2])[pc][to];
-            m.value += (*continuationHistory[3])[pc][to];
-            m.value += (*continuationHistory[5])[pc][to];
+            int value = 2 * mainHist[m.from_to()] + 2 * pawnHist[pc][to];
+            value += contHist0[pc][to] + contHist1[pc][to] + contHist2[pc][to];
+            value += contHist3[pc][to] + contHist5[pc][to];
 
             // bonus for checks
-            m.value += bool(pos.check_squares(pt) & to) * 16384;
+            value += bool(pos.check_squares(pt) & to) * 16384;
 
             // bonus for escaping from capture
-            m.value += threatenedPieces & from ? (pt == QUEEN && !(to & threatenedByRook)   ? 51700
-                                                  : pt == ROOK && !(to & threatenedByMinor) ? 25600
-                                                  : !(to & threatenedByPawn)                ? 14450
-                                                                                            : 0)
-                                               : 0;
+            value += threatenedPieces & from ? (pt == QUEEN && !(to & threatenedByRook)   ? 51700
+                                                : pt == ROOK && !(to & threatenedByMinor) ? 25600
+                                                : !(to & threatenedByPawn)                ? 14450
+                                                                                          : 0)
+                                             : 0;
 
             // malus for putting piece en prise
-            m.value -= (pt == QUEEN ? bool(to & threatenedByRook) * 49000
-                        : pt == ROOK && bool(to & threatenedByMinor) ? 24335
-                                                                     : 0);
+            value -= (pt == QUEEN ? bool(to & threatenedByRook) * 49000
+                      : pt == ROOK && bool(to & threatenedByMinor) ? 24335
+                                                                   : 0);
+            m.value = value;
+        }
 
-            if (ply < LOW_PLY_HISTORY_SIZE)
-                m.value += 8 * (*lowPlyHistory)[ply][m.from_to()] / (1 + 2 * ply);
+        // Low ply history is only kept for the first plies, so it is a separate
+        // pass rather than a branch in the loop above.
+        if (ply < LOW_PLY_HISTORY_SIZE)
+        {
+            const auto& lowPlyHist = (*lowPlyHistory)[ply];
+            for (auto& m : *this)
+                m.value += 8 * lowPlyHist[m.from_to()] / (1 + 2 * ply);
         }
+    }
+
+    else  // Type == EVASIONS
+    {
+        const auto&           mainHist  = (*mainHistory)[pos.side_to_move()];
+        const auto&           pawnHist  = (*pawnHistory)[pawn_structure_index(pos)];
+        const PieceToHistory& contHist0 = *continuationHistory[0];
 
-        else  // Type == EVASIONS
+        for (auto& m : *this)
         {
+            Piece pc = pos.moved_piece(m);
+
             if (pos.capture_stage(m))
-                m.value =
-                  PieceValue[pos.piece_on(m.to_sq())] - type_of(pos.moved_piece(m)) + (1 << 28);
+                m.value = PieceValue[pos.piece_on(m.to_sq())] - type_of(pc) + (1 << 28);
             else
-                m.value = (*mainHistory)[pos.side_to_move()][m.from_to()]
-                        + (*continuationHistory[0])[pos.moved_piece(m)][m.to_sq()]
-                        + (*pawnHistory)[pawn_structure_index(pos)][pos.moved_piece(m)][m.to_sq()];
+                m.value = mainHist[m.from_to()] + contHist0[pc][m.to_sq()]
+                        + pawnHist[pc][m.to_sq()];
         }
+    }
 }
 
 // Returns the next move satisfying a predicate function.
@@ -77,12 +77,44 @@ template void HalfKAv2_hm::append_changed_indices<BLACK>(Square            ksq,
                                                          IndexList&        removed,
                                                          IndexList&        added);
 
-int HalfKAv2_hm::update_cost(const StateInfo* st) { return st->dirtyPiece.dirty_num; }
+template<Color Perspective>
+void HalfKAv2_hm::append_move_indices(const Position& pos,
+                                      Move            m,
+                                      IndexList&      removed,
+                                      IndexList&      added) {
+    if (m.type_of() == CASTLING)
+        return;
+
+    const Square ksq   = pos.square<KING>(Perspective);
+    const Square from  = m.from_sq();
+    const Square to    = m.to_sq();
+    const Piece  pc    = pos.moved_piece(m);
+    const Square capsq = m.type_of() == EN_PASSANT ? to - pawn_push(color_of(pc)) : to;
+
+    removed.push_back(make_index<Perspective>(from, pc, ksq));
+    added.push_back(make_index<Perspective>(
+      to, m.type_of() == PROMOTION ? make_piece(color_of(pc), m.promotion_type()) : pc, ksq));
+
+    if (pos.piece_on(capsq) != NO_PIECE)
+        removed.push_back(make_index<Perspective>(capsq, pos.piece_on(capsq), ksq));
+}
+
+// Explicit template instantiations
+template void HalfKAv2_hm::append_move_indices<WHITE>(const Position& pos,
+                                                      Move            m,
+                                                      IndexList&      removed,
+                                                      IndexList&      added);
+template void HalfKAv2_hm::append_move_indices<BLACK>(const Position& pos,
+                                                      Move            m,
+                                                      IndexList&      removed,
+                                                      IndexList&      added);
+
+int HalfKAv2_hm::update_cost(const DirtyPiece& dp) { return dp.dirty_num; }
 
 int HalfKAv2_hm::refresh_cost(const Position& pos) { return pos.count<ALL_PIECES>(); }
 
-bool HalfKAv2_hm::requires_refresh(const StateInfo* st, Color perspective) {
-    return st->dirtyPiece.piece[0] == make_piece(perspective, KING);
+bool HalfKAv2_hm::requires_refresh(const DirtyPiece& dp, Color perspective) {
+    return dp.piece[0] == make_piece(perspective, KING);
 }
 
 }  // namespace Judas::Eval::NNUE::Features
@@ -28,7 +28,6 @@
 #include "../nnue_common.h"
 
 namespace Judas {
-struct StateInfo;
 class Position;
 }
 
@@ -135,14 +134,20 @@ class HalfKAv2_hm {
     static void
     append_changed_indices(Square ksq, const DirtyPiece& dp, IndexList& removed, IndexList& added);
 
+    // Get a list of indices that a move not yet made is going to change.
+    // Castling is left out, the list is only used for prefetching.
+    template<Color Perspective>
+    static void
+    append_move_indices(const Position& pos, Move m, IndexList& removed, IndexList& added);
+
     // Returns the cost of updating one perspective, the most costly one.
     // Assumes no refresh needed.
-    static int update_cost(const StateInfo* st);
+    static int update_cost(const DirtyPiece& dp);
     static int refresh_cost(const Position& pos);
 
-    // Returns whether the change stored in this StateInfo means
+    // Returns whether the change stored in this DirtyPiece means
     // that a full accumulator refresh is required.
-    static bool requires_refresh(const StateInfo* st, Color perspective);
+    static bool requires_refresh(const DirtyPiece& dp, Color perspective);
 };
 
 }  // namespace Judas::Eval::NNUE::Features
@@ -18,7 +18,9 @@
 
 #include "network.h"
 
+#include <algorithm>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <memory>
@@ -29,6 +31,7 @@
 #define INCBIN_SILENCE_BITCODE_WARNING
 #include "../incbin/incbin.h"
 
+#include "../book/file_mapping.h"
 #include "../evaluate.h"
 #include "../memory.h"
 #include "../misc.h"
@@ -107,6 +110,62 @@ bool write_parameters(std::ostream& stream, T& reference) {
     return reference.write_parameters(stream);
 }
 
+// A baked net is the in-memory image of the parameters after loading, that is
+// already permuted and scaled for the SIMD code of this build. It is loaded by
+// copying from a memory mapped file, without any decoding.
+constexpr char BakedMagic[8] = {'J', 'N', 'N', 'U', 'E', 'B', 'K', '1'};
+
+struct BakedHeader {
+    char          magic[8];
+    std::uint32_t version;
+    std::uint32_t hash;
+    std::uint32_t layout;
+    std::uint32_t layerStacks;
+    std::uint64_t transformerSize;
+    std::uint64_t archSize;
+    std::uint64_t descriptionSize;
+    std::uint64_t dataOffset;
+};
+
+// Identifies the build options that change the memory layout of the weights
+inline std::uint32_t baked_layout() {
+    std::uint32_t layout = IsLittleEndian ? 1 : 0;
+#if defined(IS_64BIT)
+    layout |= 1 << 1;
+#endif
+#if defined(USE_AVX512)
+    layout |= 1 << 2;
+#endif
+#if defined(USE_VNNI)
+    layout |= 1 << 3;
+#endif
+#if defined(USE_AVX2)
+    layout |= 1 << 4;
+#endif
+#if defined(USE_SSE41)
+    layout |= 1 << 5;
+#endif
+#if defined(USE_SSSE3)
+    layout |= 1 << 6;
+#endif
+#if defined(USE_SSE2)
+    layout |= 1 << 7;
+#endif
+#if defined(USE_MMX)
+    layout |= 1 << 8;
+#endif
+#if defined(USE_NEON)
+    layout |= (USE_NEON & 0xFF) << 9;
+#endif
+#if defined(USE_NEON_DOTPROD)
+    layout |= 1 << 17;
+#endif
+#if defined(USE_SMALLNET_INT8)
+    layout |= 1 << 18;
+#endif
+    return layout;
+}
+
 }  // namespace Detail
 
 template<typename Arch, typename Transformer>
@@ -197,8 +256,20 @@ bool Network<Arch, Transformer>::save(const std::optional<std::string>& filename
         actualFilename = evalFile.defaultName;
     }
 
-    std::ofstream stream(actualFilename, std::ios_base::binary);
-    bool          saved = save(stream, evalFile.current, evalFile.netDescription);
+    const std::string bakedExt = ".bnnue";
+    const bool        baked    = actualFilename.size() > bakedExt.size()
+                        && actualFilename.compare(actualFilename.size() - bakedExt.size(),
+                                                  bakedExt.size(), bakedExt)
+                             == 0;
+
+    bool saved;
+    if (baked)
+        saved = save_baked(actualFilename, evalFile.netDescription);
+    else
+    {
+        std::ofstream stream(actualFilename, std::ios_base::binary);
+        saved = save(stream, evalFile.current, evalFile.netDescription);
+    }
 
     msg = saved ? "Network saved successfully to " + actualFilename : "Failed to export a net";
 
@@ -210,6 +281,7 @@ bool Network<Arch, Transformer>::save(const std::optional<std::string>& filename
 template<typename Arch, typename Transformer>
 NetworkOutput
 Network<Arch, Transformer>::evaluate(const Position&                         pos,
+                                     AccumulatorStack&                       accumulators,
                                      AccumulatorCaches::Cache<FTDimensions>* cache) const {
     // We manually align the arrays on the stack because with gcc < 9.3
     // overaligning stack variables with alignas() doesn't work correctly.
@@ -230,12 +302,65 @@ Network<Arch, Transformer>::evaluate(const Position&                         pos
     ASSERT_ALIGNED(transformedFeatures, alignment);
 
     const int  bucket     = (pos.count<ALL_PIECES>() - 1) / 4;
-    const auto psqt       = featureTransformer->transform(pos, cache, transformedFeatures, bucket);
+    const auto psqt =
+      featureTransformer->transform(pos, accumulators, cache, transformedFeatures, bucket);
     const auto positional = network[bucket].propagate(transformedFeatures);
     return {static_cast<Value>(psqt / OutputScale), static_cast<Value>(positional / OutputScale)};
 }
 
 
+// Evaluates many positions at once. The features of a chunk of positions are
+// transformed first, then the positions are run through the layer stacks
+// grouped by bucket, so each stack stays in cache while its positions are
+// propagated. Each position still gets its own propagate(): running fc_0 on
+// several positions together measured slower. The positions are unrelated,
+// so the accumulator stack is reset for each of them.
+template<typename Arch, typename Transformer>
+std::vector<NetworkOutput>
+Network<Arch, Transformer>::evaluate_batch(const std::vector<const Position*>&     positions,
+                                           AccumulatorStack&                       accumulators,
+                                           AccumulatorCaches::Cache<FTDimensions>* cache) const {
+
+    constexpr size_t ChunkSize = 64;
+
+    struct alignas(CacheLineSize) Features {
+        TransformedFeatureType data[FeatureTransformer<FTDimensions, nullptr>::BufferSize];
+    };
+
+    auto features = make_unique_aligned<Features[]>(ChunkSize);
+
+    std::vector<NetworkOutput> output(positions.size());
+    std::int32_t               psqt[ChunkSize];
+    int                        buckets[ChunkSize];
+
+    for (size_t first = 0; first < positions.size(); first += ChunkSize)
+    {
+        const size_t count = std::min(ChunkSize, positions.size() - first);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const Position& pos = *positions[first + i];
+
+            accumulators.reset();
+            buckets[i] = (pos.count<ALL_PIECES>() - 1) / 4;
+            psqt[i]    = featureTransformer->transform(pos, accumulators, cache, features[i].data,
+                                                       buckets[i]);
+        }
+
+        for (int bucket = 0; bucket < int(LayerStacks); ++bucket)
+            for (size_t i = 0; i < count; ++i)
+                if (buckets[i] == bucket)
+                {
+                    const auto positional = network[bucket].propagate(features[i].data);
+                    output[first + i]     = {static_cast<Value>(psqt[i] / OutputScale),
+                                             static_cast<Value>(positional / OutputScale)};
+                }
+    }
+
+    return output;
+}
+
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::verify(std::string                                  evalfilePath,
                                         const std::function<void(std::string_view)>& f) const {
@@ -278,15 +403,68 @@ void Network<Arch, Transformer>::verify(std::string
 }
 
 
+template<typename Arch, typename Transformer>
+NetworkOutput
+Network<Arch, Transformer>::evaluate_timed(const Position&                         pos,
+                                           AccumulatorStack&                       accumulators,
+                                           AccumulatorCaches::Cache<FTDimensions>* cache,
+                                           StageTimer&                             timer,
+                                           NetworkStage updateStage) const {
+
+    constexpr uint64_t alignment = CacheLineSize;
+
+#if defined(ALIGNAS_ON_STACK_VARIABLES_BROKEN)
+    TransformedFeatureType
+      transformedFeaturesUnaligned[FeatureTransformer<FTDimensions, nullptr>::BufferSize
+                                   + alignment / sizeof(TransformedFeatureType)];
+
+    auto* transformedFeatures = align_ptr_up<alignment>(&transformedFeaturesUnaligned[0]);
+#else
+    alignas(alignment) TransformedFeatureType
+      transformedFeatures[FeatureTransformer<FTDimensions, nullptr>::BufferSize];
+#endif
+
+    ASSERT_ALIGNED(transformedFeatures, alignment);
+
+    timer.start();
+    featureTransformer->update_accumulators(pos, accumulators, cache);
+    timer(updateStage);
+
+    // The accumulators are up to date, so this only converts them
+    const int  bucket = (pos.count<ALL_PIECES>() - 1) / 4;
+    const auto psqt =
+      featureTransformer->transform(pos, accumulators, cache, transformedFeatures, bucket);
+    timer(NetworkStage::Transform);
+
+    const auto positional =
+      network[bucket].propagate(transformedFeatures, [&](NetworkStage stage) { timer(stage); });
+
+    for (NetworkStage stage : {updateStage, NetworkStage::Transform, NetworkStage::SparseAffine,
+                               NetworkStage::DenseAffine, NetworkStage::Activation})
+        timer.count(stage);
+
+    return {static_cast<Value>(psqt / OutputScale), static_cast<Value>(positional / OutputScale)};
+}
+
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::hint_common_access(
-  const Position& pos, AccumulatorCaches::Cache<FTDimensions>* cache) const {
-    featureTransformer->hint_common_access(pos, cache);
+  const Position&                         pos,
+  AccumulatorStack&                       accumulators,
+  AccumulatorCaches::Cache<FTDimensions>* cache) const {
+    featureTransformer->hint_common_access(pos, accumulators, cache);
+}
+
+template<typename Arch, typename Transformer>
+void Network<Arch, Transformer>::prefetch_move(
+  const Position& pos, Move m, AccumulatorCaches::Cache<FTDimensions>* cache) const {
+    featureTransformer->prefetch_move(pos, m, cache);
 }
 
 template<typename Arch, typename Transformer>
 NnueEvalTrace
 Network<Arch, Transformer>::trace_evaluate(const Position&                         pos,
+                                           AccumulatorStack&                       accumulators,
                                            AccumulatorCaches::Cache<FTDimensions>* cache) const {
     // We manually align the arrays on the stack because with gcc < 9.3
     // overaligning stack variables with alignas() doesn't work correctly.
@@ -310,7 +488,7 @@ Network<Arch, Transformer>::trace_evaluate(const Position&
     for (IndexType bucket = 0; bucket < LayerStacks; ++bucket)
     {
         const auto materialist =
-          featureTransformer->transform(pos, cache, transformedFeatures, bucket);
+          featureTransformer->transform(pos, accumulators, cache, transformedFeatures, bucket);
         const auto positional = network[bucket].propagate(transformedFeatures);
 
         t.psqt[bucket]       = static_cast<Value>(materialist / OutputScale);
@@ -325,7 +503,25 @@ template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::load_user_net(const std::string& dir,
                                                const std::string& evalfilePath) {
     std::ifstream stream(dir + evalfilePath, std::ios::binary);
-    auto          description = load(stream);
+
+    // Baked nets are told apart by their magic, so that a regular net is not
+    // mapped in full just to find out it has to be parsed.
+    char magic[sizeof(Detail::BakedMagic)] = {};
+    stream.read(magic, sizeof(magic));
+
+    std::optional<std::string> description;
+
+    if (stream && !std::memcmp(magic, Detail::BakedMagic, sizeof(magic)))
+    {
+        stream.close();
+        description = load_baked(dir + evalfilePath);
+    }
+    else
+    {
+        stream.clear();
+        stream.seekg(0);
+        description = load(stream);
+    }
 
     if (description.has_value())
     {
@@ -335,6 +531,95 @@ void Network<Arch, Transformer>::load_user_net(const std::string& dir,
 }
 
 
+// Loads a net written by save_baked(). Fails if the file is not a baked net or
+// was baked by a build with a different weight layout.
+template<typename Arch, typename Transformer>
+std::optional<std::string> Network<Arch, Transformer>::load_baked(const std::string& path) {
+
+    // The parameters are copied out in a single pass, so ask for readahead
+    FileMapping mapping;
+    if (!mapping.map(path, false, true) || mapping.data_size() < sizeof(Detail::BakedHeader))
+        return std::nullopt;
+
+    Detail::BakedHeader header;
+    std::memcpy(&header, mapping.data(), sizeof(header));
+
+    if (std::memcmp(header.magic, Detail::BakedMagic, sizeof(header.magic)))
+        return std::nullopt;
+
+    if (header.version != Version || header.hash != Network::hash
+        || header.layout != Detail::baked_layout() || header.layerStacks != LayerStacks
+        || header.transformerSize != sizeof(Transformer) || header.archSize != sizeof(Arch))
+    {
+        sync_cout << "info string " << path << " was baked by an incompatible build" << sync_endl;
+        return std::nullopt;
+    }
+
+    // The parameters end the file, after the header and the description. The
+    // sizes come from the file, so compare them without adding them up.
+    constexpr std::size_t ParamsSize = sizeof(Transformer) + LayerStacks * sizeof(Arch);
+
+    if (mapping.data_size() - sizeof(header) < ParamsSize
+        || header.dataOffset != mapping.data_size() - ParamsSize
+        || header.descriptionSize > header.dataOffset - sizeof(header))
+    {
+        sync_cout << "info string " << path << " is truncated or corrupt" << sync_endl;
+        return std::nullopt;
+    }
+
+    const unsigned char* data = mapping.data();
+    std::string description(reinterpret_cast<const char*>(data + sizeof(header)),
+                            header.descriptionSize);
+
+    initialize();
+
+    data += header.dataOffset;
+    std::memcpy(static_cast<void*>(featureTransformer.get()), data, sizeof(Transformer));
+    data += sizeof(Transformer);
+
+    for (std::size_t i = 0; i < LayerStacks; ++i, data += sizeof(Arch))
+        std::memcpy(static_cast<void*>(&network[i]), data, sizeof(Arch));
+
+    return description;
+}
+
+
+template<typename Arch, typename Transformer>
+bool Network<Arch, Transformer>::save_baked(const std::string& filename,
+                                            const std::string& netDescription) const {
+
+    static_assert(std::is_trivially_copyable_v<Transformer> && std::is_trivially_copyable_v<Arch>,
+                  "Baked nets are raw copies of the parameters");
+
+    Detail::BakedHeader header{};
+    std::memcpy(header.magic, Detail::BakedMagic, sizeof(header.magic));
+    header.version         = Version;
+    header.hash            = Network::hash;
+    header.layout          = Detail::baked_layout();
+    header.layerStacks     = LayerStacks;
+    header.transformerSize = sizeof(Transformer);
+    header.archSize        = sizeof(Arch);
+    header.descriptionSize = netDescription.size();
+    header.dataOffset      = (sizeof(header) + netDescription.size() + CacheLineSize - 1)
+                      / CacheLineSize * CacheLineSize;
+
+    std::ofstream stream(filename, std::ios_base::binary);
+
+    stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    stream.write(netDescription.data(), netDescription.size());
+
+    for (std::size_t i = sizeof(header) + netDescription.size(); i < header.dataOffset; ++i)
+        stream.put(0);
+
+    stream.write(reinterpret_cast<const char*>(featureTransformer.get()), sizeof(Transformer));
+
+    for (std::size_t i = 0; i < LayerStacks; ++i)
+        stream.write(reinterpret_cast<const char*>(&network[i]), sizeof(Arch));
+
+    return bool(stream);
+}
+
+
 template<typename Arch, typename Transformer>
 void Network<Arch, Transformer>::load_internal() {
     // C++ way to prepare a buffer for a memory stream
@@ -458,10 +743,10 @@ bool Network<Arch, Transformer>::write_parameters(std::ostream&      stream,
 
 template class Network<
   NetworkArchitecture<TransformedFeatureDimensionsBig, L2Big, L3Big>,
-  FeatureTransformer<TransformedFeatureDimensionsBig, &StateInfo::accumulatorBig>>;
+  FeatureTransformer<TransformedFeatureDimensionsBig, &AccumulatorState::accumulatorBig>>;
 
 template class Network<
   NetworkArchitecture<TransformedFeatureDimensionsSmall, L2Small, L3Small>,
-  FeatureTransformer<TransformedFeatureDimensionsSmall, &StateInfo::accumulatorSmall>>;
+  FeatureTransformer<TransformedFeatureDimensionsSmall, &AccumulatorState::accumulatorSmall>>;
 
 }  // namespace Judas::Eval::NNUE
@@ -27,6 +27,7 @@
 #include <string_view>
 #include <tuple>
 #include <utility>
+#include <vector>
 
 #include "../memory.h"
 #include "../position.h"
@@ -64,20 +65,42 @@ class Network {
     bool save(const std::optional<std::string>& filename) const;
 
     NetworkOutput evaluate(const Position&                         pos,
+                           AccumulatorStack&                       accumulators,
                            AccumulatorCaches::Cache<FTDimensions>* cache) const;
 
+    std::vector<NetworkOutput> evaluate_batch(const std::vector<const Position*>&     positions,
+                                              AccumulatorStack&                       accumulators,
+                                              AccumulatorCaches::Cache<FTDimensions>* cache) const;
+
 
     void hint_common_access(const Position&                         pos,
+                            AccumulatorStack&                       accumulators,
                             AccumulatorCaches::Cache<FTDimensions>* cache) const;
 
+    void prefetch_move(const Position&                         pos,
+                       Move                                    m,
+                       AccumulatorCaches::Cache<FTDimensions>* cache) const;
+
+    // Same as evaluate(), with each stage timed. The accumulator update is
+    // accounted to the given stage.
+    NetworkOutput evaluate_timed(const Position&                         pos,
+                                 AccumulatorStack&                       accumulators,
+                                 AccumulatorCaches::Cache<FTDimensions>* cache,
+                                 StageTimer&                             timer,
+                                 NetworkStage                            updateStage) const;
+
     void verify(std::string evalfilePath, const std::function<void(std::string_view)>&) const;
     NnueEvalTrace trace_evaluate(const Position&                         pos,
+                                 AccumulatorStack&                       accumulators,
                                  AccumulatorCaches::Cache<FTDimensions>* cache) const;
 
    private:
     void load_user_net(const std::string&, const std::string&);
     void load_internal();
 
+    std::optional<std::string> load_baked(const std::string&);
+    bool                       save_baked(const std::string&, const std::string&) const;
+
     void initialize();
 
     bool                       save(std::ostream&, const std::string&, const std::string&) const;
@@ -107,12 +130,12 @@ class Network {
 
 // Definitions of the network types
 using SmallFeatureTransformer =
-  FeatureTransformer<TransformedFeatureDimensionsSmall, &StateInfo::accumulatorSmall>;
+  FeatureTransformer<TransformedFeatureDimensionsSmall, &AccumulatorState::accumulatorSmall>;
 using SmallNetworkArchitecture =
   NetworkArchitecture<TransformedFeatureDimensionsSmall, L2Small, L3Small>;
 
 using BigFeatureTransformer =
-  FeatureTransformer<TransformedFeatureDimensionsBig, &StateInfo::accumulatorBig>;
+  FeatureTransformer<TransformedFeatureDimensionsBig, &AccumulatorState::accumulatorBig>;
 using BigNetworkArchitecture = NetworkArchitecture<TransformedFeatureDimensionsBig, L2Big, L3Big>;
 
 using NetworkBig   = Network<BigNetworkArchitecture, BigFeatureTransformer>;
@@ -21,8 +21,12 @@
 #ifndef NNUE_ACCUMULATOR_H_INCLUDED
 #define NNUE_ACCUMULATOR_H_INCLUDED
 
+#include <array>
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
 
+#include "../types.h"
 #include "nnue_architecture.h"
 #include "nnue_common.h"
 
@@ -41,6 +45,58 @@ struct alignas(CacheLineSize) Accumulator {
 };
 
 
+// AccumulatorState holds the accumulators of both networks for one ply,
+// along with the piece changes of the move that led to that ply.
+struct AccumulatorState {
+    Accumulator<TransformedFeatureDimensionsBig>   accumulatorBig;
+    Accumulator<TransformedFeatureDimensionsSmall> accumulatorSmall;
+    DirtyPiece                                     dirtyPiece;
+
+    void reset(const DirtyPiece& dp) {
+        dirtyPiece                       = dp;
+        accumulatorBig.computed[WHITE]   = accumulatorBig.computed[BLACK]   = false;
+        accumulatorSmall.computed[WHITE] = accumulatorSmall.computed[BLACK] = false;
+    }
+};
+
+
+// AccumulatorStack is the per-thread stack of accumulator states indexed by
+// ply from the search root. The search pushes the DirtyPiece of every move it
+// makes and pops it on undo, so the accumulators are only ever touched by the
+// evaluation, which updates them incrementally from the nearest computed ply.
+class AccumulatorStack {
+   public:
+    static constexpr std::size_t MaxSize = MAX_PLY + 1;
+
+    void reset() {
+        states[0].reset({0, {NO_PIECE}, {SQ_NONE}, {SQ_NONE}});
+        count = 1;
+    }
+
+    void push(const DirtyPiece& dp) {
+        assert(count < MaxSize);
+        states[count++].reset(dp);
+    }
+
+    void pop() {
+        assert(count > 1);
+        --count;
+    }
+
+    std::size_t size() const { return count; }
+
+    AccumulatorState&       latest() { return states[count - 1]; }
+    const AccumulatorState& latest() const { return states[count - 1]; }
+
+    AccumulatorState&       operator[](std::size_t idx) { return states[idx]; }
+    const AccumulatorState& operator[](std::size_t idx) const { return states[idx]; }
+
+   private:
+    std::array<AccumulatorState, MaxSize> states;
+    std::size_t                           count = 1;
+};
+
+
 // AccumulatorCaches struct provides per-thread accumulator caches, where each
 // cache contains multiple entries for each of the possible king squares.
 // When the accumulator needs to be refreshed, the cached entry is used to more
@@ -49,6 +49,22 @@ constexpr int       L3Small                           = 32;
 constexpr IndexType PSQTBuckets = 8;
 constexpr IndexType LayerStacks = 8;
 
+// Stages of an evaluation. propagate() reports the end of each of its stages
+// to an optional probe, which nnuebench uses to time them.
+enum class NetworkStage {
+    Incremental,
+    Refresh,
+    Transform,
+    SparseAffine,
+    DenseAffine,
+    Activation,
+    Count
+};
+
+struct NoStageProbe {
+    void operator()(NetworkStage) const {}
+};
+
 template<IndexType L1, int L2, int L3>
 struct NetworkArchitecture {
     static constexpr IndexType TransformedFeatureDimensions = L1;
@@ -91,7 +107,9 @@ struct NetworkArchitecture {
             && fc_2.write_parameters(stream);
     }
 
-    std::int32_t propagate(const TransformedFeatureType* transformedFeatures) {
+    template<typename StageProbe = NoStageProbe>
+    std::int32_t propagate(const TransformedFeatureType* transformedFeatures,
+                           StageProbe                    probe = StageProbe()) {
         struct alignas(CacheLineSize) Buffer {
             alignas(CacheLineSize) typename decltype(fc_0)::OutputBuffer fc_0_out;
             alignas(CacheLineSize) typename decltype(ac_sqr_0)::OutputType
@@ -114,13 +132,18 @@ struct NetworkArchitecture {
 #endif
 
         fc_0.propagate(transformedFeatures, buffer.fc_0_out);
+        probe(NetworkStage::SparseAffine);
         ac_sqr_0.propagate(buffer.fc_0_out, buffer.ac_sqr_0_out);
         ac_0.propagate(buffer.fc_0_out, buffer.ac_0_out);
         std::memcpy(buffer.ac_sqr_0_out + FC_0_OUTPUTS, buffer.ac_0_out,
                     FC_0_OUTPUTS * sizeof(typename decltype(ac_0)::OutputType));
+        probe(NetworkStage::Activation);
         fc_1.propagate(buffer.ac_sqr_0_out, buffer.fc_1_out);
+        probe(NetworkStage::DenseAffine);
         ac_1.propagate(buffer.fc_1_out, buffer.ac_1_out);
+        probe(NetworkStage::Activation);
         fc_2.propagate(buffer.ac_1_out, buffer.fc_2_out);
+        probe(NetworkStage::DenseAffine);
 
         // buffer.fc_0_out[FC_0_OUTPUTS] is such that 1.0 is equal to 127*(1<<WeightScaleBits) in
         // quantized form, but we want 1.0 to be equal to 600*OutputScale
@@ -24,10 +24,14 @@
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <iosfwd>
+#include <memory>
+#include <type_traits>
 #include <utility>
 
+#include "../misc.h"
 #include "../position.h"
 #include "../types.h"
 #include "nnue_accumulator.h"
@@ -61,6 +65,8 @@ using psqt_vec_t = __m256i;
     #define vec_max_16(a, b) _mm512_max_epi16(a, b)
     #define vec_min_16(a, b) _mm512_min_epi16(a, b)
     #define vec_slli_16(a, b) _mm512_slli_epi16(a, b)
+    #define vec_load_8_to_16(a) \
+        _mm512_cvtepi8_epi16(_mm256_load_si256(reinterpret_cast<const __m256i*>(a)))
     // Inverse permuted at load time
     #define vec_packus_16(a, b) _mm512_packus_epi16(a, b)
     #define vec_load_psqt(a) _mm256_load_si256(a)
@@ -84,6 +90,8 @@ using psqt_vec_t = __m256i;
     #define vec_max_16(a, b) _mm256_max_epi16(a, b)
     #define vec_min_16(a, b) _mm256_min_epi16(a, b)
     #define vec_slli_16(a, b) _mm256_slli_epi16(a, b)
+    #define vec_load_8_to_16(a) \
+        _mm256_cvtepi8_epi16(_mm_load_si128(reinterpret_cast<const __m128i*>(a)))
     // Inverse permuted at load time
     #define vec_packus_16(a, b) _mm256_packus_epi16(a, b)
     #define vec_load_psqt(a) _mm256_load_si256(a)
@@ -107,6 +115,11 @@ using psqt_vec_t = __m128i;
     #define vec_max_16(a, b) _mm_max_epi16(a, b)
     #define vec_min_16(a, b) _mm_min_epi16(a, b)
     #define vec_slli_16(a, b) _mm_slli_epi16(a, b)
+    #define vec_load_8_to_16(a) \
+        _mm_srai_epi16( \
+          _mm_unpacklo_epi8(_mm_setzero_si128(), \
+                            _mm_loadl_epi64(reinterpret_cast<const __m128i*>(a))), \
+          8)
     #define vec_packus_16(a, b) _mm_packus_epi16(a, b)
     #define vec_load_psqt(a) (*(a))
     #define vec_store_psqt(a, b) *(a) = (b)
@@ -130,6 +143,7 @@ using psqt_vec_t = int32x4_t;
     #define vec_max_16(a, b) vmaxq_s16(a, b)
     #define vec_min_16(a, b) vminq_s16(a, b)
     #define vec_slli_16(a, b) vshlq_s16(a, vec_set_16(b))
+    #define vec_load_8_to_16(a) vmovl_s8(vld1_s8(reinterpret_cast<const std::int8_t*>(a)))
     #define vec_packus_16(a, b) reinterpret_cast<vec_t>(vcombine_u8(vqmovun_s16(a), vqmovun_s16(b)))
     #define vec_load_psqt(a) (*(a))
     #define vec_store_psqt(a, b) *(a) = (b)
@@ -189,12 +203,27 @@ static constexpr int BestRegisterCount() {
 
 // Input feature converter
 template<IndexType                                 TransformedFeatureDimensions,
-         Accumulator<TransformedFeatureDimensions> StateInfo::*accPtr>
+         Accumulator<TransformedFeatureDimensions> AccumulatorState::*accPtr>
 class FeatureTransformer {
 
     // Number of output dimensions for one side
     static constexpr IndexType HalfDimensions = TransformedFeatureDimensions;
 
+    // Number of cache lines of each weight row touched by prefetch_move()
+    static constexpr std::size_t PrefetchLines = 16;
+
+    // With USE_SMALLNET_INT8 the weights of the small network are stored as
+    // int8, scaled down by a power of two chosen at load time, which halves
+    // the memory traffic of its updates. The accumulators stay int16 and hold
+    // the scaled sums, which transform() scales back.
+#if defined(USE_SMALLNET_INT8)
+    static constexpr bool Int8Weights =
+      TransformedFeatureDimensions == TransformedFeatureDimensionsSmall;
+#else
+    static constexpr bool Int8Weights = false;
+#endif
+    using StoredWeightType = std::conditional_t<Int8Weights, std::int8_t, WeightType>;
+
    private:
 #ifdef VECTOR
     static constexpr int NumRegs =
@@ -256,20 +285,22 @@ class FeatureTransformer {
 #endif
     }
 
-    void permute_weights([[maybe_unused]] void (*order_fn)(uint64_t*)) {
+    static void permute_weights([[maybe_unused]] BiasType*   biasesIn,
+                                [[maybe_unused]] WeightType* weightsIn,
+                                [[maybe_unused]] void (*order_fn)(uint64_t*)) {
 #if defined(USE_AVX2)
     #if defined(USE_AVX512)
         constexpr IndexType di = 16;
     #else
         constexpr IndexType di = 8;
     #endif
-        uint64_t* b = reinterpret_cast<uint64_t*>(&biases[0]);
+        uint64_t* b = reinterpret_cast<uint64_t*>(&biasesIn[0]);
         for (IndexType i = 0; i < HalfDimensions * sizeof(BiasType) / sizeof(uint64_t); i += di)
             order_fn(&b[i]);
 
         for (IndexType j = 0; j < InputDimensions; ++j)
         {
-            uint64_t* w = reinterpret_cast<uint64_t*>(&weights[j * HalfDimensions]);
+            uint64_t* w = reinterpret_cast<uint64_t*>(&weightsIn[j * HalfDimensions]);
             for (IndexType i = 0; i < HalfDimensions * sizeof(WeightType) / sizeof(uint64_t);
                  i += di)
                 order_fn(&w[i]);
@@ -277,60 +308,118 @@ class FeatureTransformer {
 #endif
     }
 
-    inline void scale_weights(bool read) {
+    static void scale_weights(BiasType* biasesIn, WeightType* weightsIn, bool read) {
         for (IndexType j = 0; j < InputDimensions; ++j)
         {
-            WeightType* w = &weights[j * HalfDimensions];
+            WeightType* w = &weightsIn[j * HalfDimensions];
             for (IndexType i = 0; i < HalfDimensions; ++i)
                 w[i] = read ? w[i] * 2 : w[i] / 2;
         }
 
         for (IndexType i = 0; i < HalfDimensions; ++i)
-            biases[i] = read ? biases[i] * 2 : biases[i] / 2;
+            biasesIn[i] = read ? biasesIn[i] * 2 : biasesIn[i] / 2;
+    }
+
+    // Stores the int16 weights as int8 with the smallest power of two scale
+    // that fits them all, and scales the biases the same way. Nets whose
+    // weights fit in int8 before the load time doubling convert exactly.
+    void narrow_weights(const WeightType* wideWeights) {
+
+        auto scaled = [&](int v) {
+            return weightShift ? (v + (1 << (weightShift - 1))) >> weightShift : v;
+        };
+
+        int maxWeight = 0;
+        for (IndexType i = 0; i < HalfDimensions * InputDimensions; ++i)
+            maxWeight = std::max(maxWeight, std::abs(int(wideWeights[i])));
+
+        for (weightShift = 0; scaled(maxWeight) > 127; ++weightShift)
+        {}
+
+        for (IndexType i = 0; i < HalfDimensions * InputDimensions; ++i)
+            weights[i] = StoredWeightType(scaled(wideWeights[i]));
+
+        for (IndexType i = 0; i < HalfDimensions; ++i)
+            biases[i] = BiasType(scaled(biases[i]));
     }
 
     // Read network parameters
     bool read_parameters(std::istream& stream) {
 
         read_leb_128<BiasType>(stream, biases, HalfDimensions);
-        read_leb_128<WeightType>(stream, weights, HalfDimensions * InputDimensions);
-        read_leb_128<PSQTWeightType>(stream, psqtWeights, PSQTBuckets * InputDimensions);
 
-        permute_weights(inverse_order_packs);
-        scale_weights(true);
+        if constexpr (Int8Weights)
+        {
+            auto wideWeights = std::make_unique<WeightType[]>(HalfDimensions * InputDimensions);
+            read_leb_128<WeightType>(stream, wideWeights.get(), HalfDimensions * InputDimensions);
+
+            permute_weights(biases, wideWeights.get(), inverse_order_packs);
+            scale_weights(biases, wideWeights.get(), true);
+            narrow_weights(wideWeights.get());
+        }
+        else
+        {
+            read_leb_128<WeightType>(stream, weights, HalfDimensions * InputDimensions);
+
+            permute_weights(biases, weights, inverse_order_packs);
+            scale_weights(biases, weights, true);
+        }
+
+        read_leb_128<PSQTWeightType>(stream, psqtWeights, PSQTBuckets * InputDimensions);
         return !stream.fail();
     }
 
-    // Write network parameters
+    // Write network parameters. Int8 weights are widened back, so the file
+    // is in the usual format.
     bool write_parameters(std::ostream& stream) {
 
-        permute_weights(order_packs);
-        scale_weights(false);
+        if constexpr (Int8Weights)
+        {
+            BiasType wideBiases[HalfDimensions];
+            auto     wideWeights = std::make_unique<WeightType[]>(HalfDimensions * InputDimensions);
 
-        write_leb_128<BiasType>(stream, biases, HalfDimensions);
-        write_leb_128<WeightType>(stream, weights, HalfDimensions * InputDimensions);
-        write_leb_128<PSQTWeightType>(stream, psqtWeights, PSQTBuckets * InputDimensions);
+            for (IndexType i = 0; i < HalfDimensions; ++i)
+                wideBiases[i] = BiasType(biases[i] * (1 << weightShift));
+            for (IndexType i = 0; i < HalfDimensions * InputDimensions; ++i)
+                wideWeights[i] = WeightType(weights[i] * (1 << weightShift));
+
+            scale_weights(wideBiases, wideWeights.get(), false);
+            permute_weights(wideBiases, wideWeights.get(), order_packs);
 
-        permute_weights(inverse_order_packs);
-        scale_weights(true);
+            write_leb_128<BiasType>(stream, wideBiases, HalfDimensions);
+            write_leb_128<WeightType>(stream, wideWeights.get(), HalfDimensions * InputDimensions);
+        }
+        else
+        {
+            permute_weights(biases, weights, order_packs);
+            scale_weights(biases, weights, false);
+
+            write_leb_128<BiasType>(stream, biases, HalfDimensions);
+            write_leb_128<WeightType>(stream, weights, HalfDimensions * InputDimensions);
+
+            permute_weights(biases, weights, inverse_order_packs);
+            scale_weights(biases, weights, true);
+        }
+
+        write_leb_128<PSQTWeightType>(stream, psqtWeights, PSQTBuckets * InputDimensions);
         return !stream.fail();
     }
 
     // Convert input features
     std::int32_t transform(const Position&                           pos,
+                           AccumulatorStack&                         stack,
                            AccumulatorCaches::Cache<HalfDimensions>* cache,
                            OutputType*                               output,
                            int                                       bucket) const {
-        update_accumulator<WHITE>(pos, cache);
-        update_accumulator<BLACK>(pos, cache);
+        update_accumulators(pos, stack, cache);
 
         const Color perspectives[2]  = {pos.side_to_move(), ~pos.side_to_move()};
-        const auto& psqtAccumulation = (pos.state()->*accPtr).psqtAccumulation;
+        const auto& psqtAccumulation = (stack.latest().*accPtr).psqtAccumulation;
         const auto  psqt =
           (psqtAccumulation[perspectives[0]][bucket] - psqtAccumulation[perspectives[1]][bucket])
           / 2;
 
-        const auto& accumulation = (pos.state()->*accPtr).accumulation;
+        const auto& accumulation = (stack.latest().*accPtr).accumulation;
 
         for (IndexType p = 0; p < 2; ++p)
         {
@@ -410,6 +499,31 @@ class FeatureTransformer {
               6;
     #endif
 
+            if constexpr (Int8Weights)
+            {
+                // The accumulators hold sums scaled down by the weights, see
+                // narrow_weights(), so clip in that domain and scale back.
+                const vec_t OneS = vec_set_16((127 * 2) >> weightShift);
+
+                for (IndexType j = 0; j < NumOutputChunks; ++j)
+                {
+                    const vec_t sum0a = vec_slli_16(
+                      vec_max_16(vec_min_16(in0[j * 2 + 0], OneS), Zero), shift + weightShift);
+                    const vec_t sum0b = vec_slli_16(
+                      vec_max_16(vec_min_16(in0[j * 2 + 1], OneS), Zero), shift + weightShift);
+                    const vec_t sum1a =
+                      vec_slli_16(vec_max_16(vec_min_16(in1[j * 2 + 0], OneS), Zero), weightShift);
+                    const vec_t sum1b =
+                      vec_slli_16(vec_max_16(vec_min_16(in1[j * 2 + 1], OneS), Zero), weightShift);
+
+                    const vec_t pa = vec_mulhi_16(sum0a, sum1a);
+                    const vec_t pb = vec_mulhi_16(sum0b, sum1b);
+
+                    out[j] = vec_packus_16(pa, pb);
+                }
+                continue;
+            }
+
             for (IndexType j = 0; j < NumOutputChunks; ++j)
             {
                 const vec_t sum0a =
@@ -432,8 +546,10 @@ class FeatureTransformer {
                 BiasType sum0 = accumulation[static_cast<int>(perspectives[p])][j + 0];
                 BiasType sum1 =
                   accumulation[static_cast<int>(perspectives[p])][j + HalfDimensions / 2];
-                sum0               = std::clamp<BiasType>(sum0, 0, 127 * 2);
-                sum1               = std::clamp<BiasType>(sum1, 0, 127 * 2);
+                sum0               = std::clamp<BiasType>(sum0, 0, (127 * 2) >> weightShift);
+                sum1               = std::clamp<BiasType>(sum1, 0, (127 * 2) >> weightShift);
+                sum0               = BiasType(sum0 * (1 << weightShift));
+                sum1               = BiasType(sum1 * (1 << weightShift));
                 output[offset + j] = static_cast<OutputType>(unsigned(sum0 * sum1) / 512);
             }
 
@@ -443,37 +559,81 @@ class FeatureTransformer {
         return psqt;
     }  // end of function transform()
 
+    // Brings the accumulators of the current ply up to date for both
+    // perspectives, which transform() does first
+    void update_accumulators(const Position&                           pos,
+                             AccumulatorStack&                         stack,
+                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
+        update_accumulator<WHITE>(pos, stack, cache);
+        update_accumulator<BLACK>(pos, stack, cache);
+    }
+
     void hint_common_access(const Position&                           pos,
+                            AccumulatorStack&                         stack,
                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
-        hint_common_access_for_perspective<WHITE>(pos, cache);
-        hint_common_access_for_perspective<BLACK>(pos, cache);
+        hint_common_access_for_perspective<WHITE>(pos, stack, cache);
+        hint_common_access_for_perspective<BLACK>(pos, stack, cache);
+    }
+
+    // Prefetches the start of the weight rows that a move not yet made is
+    // going to add and remove, or of the cache entry the king move will be
+    // refreshed from. The hardware prefetcher streams in the rest.
+    void prefetch_move(const Position&                           pos,
+                       Move                                      m,
+                       AccumulatorCaches::Cache<HalfDimensions>* cache) const {
+        prefetch_move_for_perspective<WHITE>(pos, m, cache);
+        prefetch_move_for_perspective<BLACK>(pos, m, cache);
     }
 
    private:
+    // Estimated cost of refreshing the accumulator from the cache entry of the
+    // king square, in features to be added/subtracted plus the extra passes
+    // over the accumulator needed to copy the entry in and out. It is never
+    // more than a full refresh, which is the bound used for the cost model.
     template<Color Perspective>
-    StateInfo* try_find_computed_accumulator(const Position& pos) const {
-        // Look for a usable accumulator of an earlier position. We keep track
+    int refresh_cost(const Position& pos, AccumulatorCaches::Cache<HalfDimensions>* cache) const {
+        constexpr int RefreshPasses = 2;
+
+        const auto& entry = (*cache)[pos.square<KING>(Perspective)][Perspective];
+        int         cost  = RefreshPasses;
+
+        for (Color c : {WHITE, BLACK})
+            for (PieceType pt = PAWN; pt <= KING; ++pt)
+                cost += popcount((entry.byColorBB[c] & entry.byTypeBB[pt]) ^ pos.pieces(c, pt));
+
+        return std::min(cost, FeatureSet::refresh_cost(pos));
+    }
+
+    template<Color Perspective>
+    std::size_t
+    try_find_computed_accumulator(const Position&                           pos,
+                                  const AccumulatorStack&                   stack,
+                                  AccumulatorCaches::Cache<HalfDimensions>* cache) const {
+        // Look for a usable accumulator of an earlier ply. We keep track
         // of the estimated gain in terms of features to be added/subtracted.
-        StateInfo* st   = pos.state();
-        int        gain = FeatureSet::refresh_cost(pos);
-        while (st->previous && !(st->*accPtr).computed[Perspective])
+        std::size_t idx  = stack.size() - 1;
+        int         gain = refresh_cost<Perspective>(pos, cache);
+        while (idx > 0 && !(stack[idx].*accPtr).computed[Perspective])
         {
             // This governs when a full feature refresh is needed and how many
             // updates are better than just one full refresh.
-            if (FeatureSet::requires_refresh(st, Perspective)
-                || (gain -= FeatureSet::update_cost(st) + 1) < 0)
+            const DirtyPiece& dp = stack[idx].dirtyPiece;
+            if (FeatureSet::requires_refresh(dp, Perspective)
+                || (gain -= FeatureSet::update_cost(dp) + 1) < 0)
                 break;
-            st = st->previous;
+            --idx;
         }
-        return st;
+        return idx;
     }
 
     // It computes the accumulator of the next position, or updates the
     // current position's accumulator if CurrentOnly is true.
     template<Color Perspective, bool CurrentOnly>
-    void update_accumulator_incremental(const Position& pos, StateInfo* computed) const {
-        assert((computed->*accPtr).computed[Perspective]);
-        assert(computed->next != nullptr);
+    void update_accumulator_incremental(const Position&   pos,
+                                        AccumulatorStack& stack,
+                                        std::size_t       computed) const {
+        assert((stack[computed].*accPtr).computed[Perspective]);
+        assert(computed + 1 < stack.size());
 
 #ifdef VECTOR
         // Gcc-10.2 unnecessarily spills AVX2 registers if this array
@@ -491,47 +651,47 @@ class FeatureTransformer {
         FeatureSet::IndexList removed, added;
 
         if constexpr (CurrentOnly)
-            for (StateInfo* st = pos.state(); st != computed; st = st->previous)
-                FeatureSet::append_changed_indices<Perspective>(ksq, st->dirtyPiece, removed,
-                                                                added);
+            for (std::size_t idx = stack.size() - 1; idx > computed; --idx)
+                FeatureSet::append_changed_indices<Perspective>(ksq, stack[idx].dirtyPiece,
+                                                                removed, added);
         else
-            FeatureSet::append_changed_indices<Perspective>(ksq, computed->next->dirtyPiece,
+            FeatureSet::append_changed_indices<Perspective>(ksq, stack[computed + 1].dirtyPiece,
                                                             removed, added);
 
-        StateInfo* next = CurrentOnly ? pos.state() : computed->next;
-        assert(!(next->*accPtr).computed[Perspective]);
+        const std::size_t next = CurrentOnly ? stack.size() - 1 : computed + 1;
+        assert(!(stack[next].*accPtr).computed[Perspective]);
 
 #ifdef VECTOR
         if ((removed.size() == 1 || removed.size() == 2) && added.size() == 1)
         {
-            auto accIn =
-              reinterpret_cast<const vec_t*>(&(computed->*accPtr).accumulation[Perspective][0]);
-            auto accOut = reinterpret_cast<vec_t*>(&(next->*accPtr).accumulation[Perspective][0]);
+            auto accIn = reinterpret_cast<const vec_t*>(
+              &(stack[computed].*accPtr).accumulation[Perspective][0]);
+            auto accOut =
+              reinterpret_cast<vec_t*>(&(stack[next].*accPtr).accumulation[Perspective][0]);
 
             const IndexType offsetR0 = HalfDimensions * removed[0];
-            auto            columnR0 = reinterpret_cast<const vec_t*>(&weights[offsetR0]);
             const IndexType offsetA  = HalfDimensions * added[0];
-            auto            columnA  = reinterpret_cast<const vec_t*>(&weights[offsetA]);
 
             if (removed.size() == 1)
             {
-                for (IndexType i = 0; i < HalfDimensions * sizeof(WeightType) / sizeof(vec_t); ++i)
-                    accOut[i] = vec_add_16(vec_sub_16(accIn[i], columnR0[i]), columnA[i]);
+                for (IndexType i = 0; i < HalfDimensions * sizeof(BiasType) / sizeof(vec_t); ++i)
+                    accOut[i] = vec_add_16(vec_sub_16(accIn[i], weight_vec(offsetR0, i)),
+                                           weight_vec(offsetA, i));
             }
             else
             {
                 const IndexType offsetR1 = HalfDimensions * removed[1];
-                auto            columnR1 = reinterpret_cast<const vec_t*>(&weights[offsetR1]);
 
-                for (IndexType i = 0; i < HalfDimensions * sizeof(WeightType) / sizeof(vec_t); ++i)
-                    accOut[i] = vec_sub_16(vec_add_16(accIn[i], columnA[i]),
-                                           vec_add_16(columnR0[i], columnR1[i]));
+                for (IndexType i = 0; i < HalfDimensions * sizeof(BiasType) / sizeof(vec_t); ++i)
+                    accOut[i] =
+                      vec_sub_16(vec_add_16(accIn[i], weight_vec(offsetA, i)),
+                                 vec_add_16(weight_vec(offsetR0, i), weight_vec(offsetR1, i)));
             }
 
             auto accPsqtIn = reinterpret_cast<const psqt_vec_t*>(
-              &(computed->*accPtr).psqtAccumulation[Perspective][0]);
-            auto accPsqtOut =
-              reinterpret_cast<psqt_vec_t*>(&(next->*accPtr).psqtAccumulation[Perspective][0]);
+              &(stack[computed].*accPtr).psqtAccumulation[Perspective][0]);
+            auto accPsqtOut = reinterpret_cast<psqt_vec_t*>(
+              &(stack[next].*accPtr).psqtAccumulation[Perspective][0]);
 
             const IndexType offsetPsqtR0 = PSQTBuckets * removed[0];
             auto columnPsqtR0 = reinterpret_cast<const psqt_vec_t*>(&psqtWeights[offsetPsqtR0]);
@@ -563,7 +723,7 @@ class FeatureTransformer {
             {
                 // Load accumulator
                 auto accTileIn = reinterpret_cast<const vec_t*>(
-                  &(computed->*accPtr).accumulation[Perspective][i * TileHeight]);
+                  &(stack[computed].*accPtr).accumulation[Perspective][i * TileHeight]);
                 for (IndexType j = 0; j < NumRegs; ++j)
                     acc[j] = vec_load(&accTileIn[j]);
 
@@ -571,23 +731,21 @@ class FeatureTransformer {
                 for (const auto index : removed)
                 {
                     const IndexType offset = HalfDimensions * index + i * TileHeight;
-                    auto            column = reinterpret_cast<const vec_t*>(&weights[offset]);
                     for (IndexType j = 0; j < NumRegs; ++j)
-                        acc[j] = vec_sub_16(acc[j], column[j]);
+                        acc[j] = vec_sub_16(acc[j], weight_vec(offset, j));
                 }
 
                 // Difference calculation for the activated features
                 for (const auto index : added)
                 {
                     const IndexType offset = HalfDimensions * index + i * TileHeight;
-                    auto            column = reinterpret_cast<const vec_t*>(&weights[offset]);
                     for (IndexType j = 0; j < NumRegs; ++j)
-                        acc[j] = vec_add_16(acc[j], column[j]);
+                        acc[j] = vec_add_16(acc[j], weight_vec(offset, j));
                 }
 
                 // Store accumulator
                 auto accTileOut = reinterpret_cast<vec_t*>(
-                  &(next->*accPtr).accumulation[Perspective][i * TileHeight]);
+                  &(stack[next].*accPtr).accumulation[Perspective][i * TileHeight]);
                 for (IndexType j = 0; j < NumRegs; ++j)
                     vec_store(&accTileOut[j], acc[j]);
             }
@@ -596,7 +754,7 @@ class FeatureTransformer {
             {
                 // Load accumulator
                 auto accTilePsqtIn = reinterpret_cast<const psqt_vec_t*>(
-                  &(computed->*accPtr).psqtAccumulation[Perspective][i * PsqtTileHeight]);
+                  &(stack[computed].*accPtr).psqtAccumulation[Perspective][i * PsqtTileHeight]);
                 for (std::size_t j = 0; j < NumPsqtRegs; ++j)
                     psqt[j] = vec_load_psqt(&accTilePsqtIn[j]);
 
@@ -620,17 +778,17 @@ class FeatureTransformer {
 
                 // Store accumulator
                 auto accTilePsqtOut = reinterpret_cast<psqt_vec_t*>(
-                  &(next->*accPtr).psqtAccumulation[Perspective][i * PsqtTileHeight]);
+                  &(stack[next].*accPtr).psqtAccumulation[Perspective][i * PsqtTileHeight]);
                 for (std::size_t j = 0; j < NumPsqtRegs; ++j)
                     vec_store_psqt(&accTilePsqtOut[j], psqt[j]);
             }
         }
 #else
-        std::memcpy((next->*accPtr).accumulation[Perspective],
-                    (computed->*accPtr).accumulation[Perspective],
+        std::memcpy((stack[next].*accPtr).accumulation[Perspective],
+                    (stack[computed].*accPtr).accumulation[Perspective],
                     HalfDimensions * sizeof(BiasType));
-        std::memcpy((next->*accPtr).psqtAccumulation[Perspective],
-                    (computed->*accPtr).psqtAccumulation[Perspective],
+        std::memcpy((stack[next].*accPtr).psqtAccumulation[Perspective],
+                    (stack[computed].*accPtr).psqtAccumulation[Perspective],
                     PSQTBuckets * sizeof(PSQTWeightType));
 
         // Difference calculation for the deactivated features
@@ -638,10 +796,10 @@ class FeatureTransformer {
         {
             const IndexType offset = HalfDimensions * index;
             for (IndexType i = 0; i < HalfDimensions; ++i)
-                (next->*accPtr).accumulation[Perspective][i] -= weights[offset + i];
+                (stack[next].*accPtr).accumulation[Perspective][i] -= weights[offset + i];
 
             for (std::size_t i = 0; i < PSQTBuckets; ++i)
-                (next->*accPtr).psqtAccumulation[Perspective][i] -=
+                (stack[next].*accPtr).psqtAccumulation[Perspective][i] -=
                   psqtWeights[index * PSQTBuckets + i];
         }
 
@@ -650,22 +808,23 @@ class FeatureTransformer {
         {
             const IndexType offset = HalfDimensions * index;
             for (IndexType i = 0; i < HalfDimensions; ++i)
-                (next->*accPtr).accumulation[Perspective][i] += weights[offset + i];
+                (stack[next].*accPtr).accumulation[Perspective][i] += weights[offset + i];
 
             for (std::size_t i = 0; i < PSQTBuckets; ++i)
-                (next->*accPtr).psqtAccumulation[Perspective][i] +=
+                (stack[next].*accPtr).psqtAccumulation[Perspective][i] +=
                   psqtWeights[index * PSQTBuckets + i];
         }
 #endif
 
-        (next->*accPtr).computed[Perspective] = true;
+        (stack[next].*accPtr).computed[Perspective] = true;
 
-        if (!CurrentOnly && next != pos.state())
-            update_accumulator_incremental<Perspective, false>(pos, next);
+        if (!CurrentOnly && next != stack.size() - 1)
+            update_accumulator_incremental<Perspective, false>(pos, stack, next);
     }
 
     template<Color Perspective>
     void update_accumulator_refresh_cache(const Position&                           pos,
+                                          AccumulatorStack&                         stack,
                                           AccumulatorCaches::Cache<HalfDimensions>* cache) const {
         assert(cache != nullptr);
 
@@ -696,7 +855,7 @@ class FeatureTransformer {
             }
         }
 
-        auto& accumulator                 = pos.state()->*accPtr;
+        auto& accumulator                 = stack.latest().*accPtr;
         accumulator.computed[Perspective] = true;
 
 #ifdef VECTOR
@@ -717,31 +876,28 @@ class FeatureTransformer {
             {
                 IndexType       indexR  = removed[i];
                 const IndexType offsetR = HalfDimensions * indexR + j * TileHeight;
-                auto            columnR = reinterpret_cast<const vec_t*>(&weights[offsetR]);
                 IndexType       indexA  = added[i];
                 const IndexType offsetA = HalfDimensions * indexA + j * TileHeight;
-                auto            columnA = reinterpret_cast<const vec_t*>(&weights[offsetA]);
 
                 for (unsigned k = 0; k < NumRegs; ++k)
-                    acc[k] = vec_add_16(acc[k], vec_sub_16(columnA[k], columnR[k]));
+                    acc[k] = vec_add_16(acc[k],
+                                        vec_sub_16(weight_vec(offsetA, k), weight_vec(offsetR, k)));
             }
             for (; i < int(removed.size()); ++i)
             {
                 IndexType       index  = removed[i];
                 const IndexType offset = HalfDimensions * index + j * TileHeight;
-                auto            column = reinterpret_cast<const vec_t*>(&weights[offset]);
 
                 for (unsigned k = 0; k < NumRegs; ++k)
-                    acc[k] = vec_sub_16(acc[k], column[k]);
+                    acc[k] = vec_sub_16(acc[k], weight_vec(offset, k));
             }
             for (; i < int(added.size()); ++i)
             {
                 IndexType       index  = added[i];
                 const IndexType offset = HalfDimensions * index + j * TileHeight;
-                auto            column = reinterpret_cast<const vec_t*>(&weights[offset]);
 
                 for (unsigned k = 0; k < NumRegs; ++k)
-                    acc[k] = vec_add_16(acc[k], column[k]);
+                    acc[k] = vec_add_16(acc[k], weight_vec(offset, k));
             }
 
             for (IndexType k = 0; k < NumRegs; k++)
@@ -823,8 +979,38 @@ class FeatureTransformer {
             entry.byTypeBB[pt] = pos.pieces(pt);
     }
 
+    static void prefetch_row(const void* row) {
+        constexpr std::size_t RowSize = HalfDimensions * sizeof(StoredWeightType);
+        constexpr std::size_t Size = std::min<std::size_t>(RowSize, PrefetchLines * CacheLineSize);
+
+        for (std::size_t i = 0; i < Size; i += CacheLineSize)
+            prefetch(static_cast<const char*>(row) + i);
+    }
+
+    template<Color Perspective>
+    void prefetch_move_for_perspective(const Position&                           pos,
+                                       Move                                      m,
+                                       AccumulatorCaches::Cache<HalfDimensions>* cache) const {
+
+        if (pos.moved_piece(m) == make_piece(Perspective, KING))
+        {
+            if (m.type_of() != CASTLING)
+                prefetch_row(&(*cache)[m.to_sq()][Perspective]);
+            return;
+        }
+
+        FeatureSet::IndexList removed, added;
+        FeatureSet::append_move_indices<Perspective>(pos, m, removed, added);
+
+        for (const auto index : removed)
+            prefetch_row(&weights[HalfDimensions * index]);
+        for (const auto index : added)
+            prefetch_row(&weights[HalfDimensions * index]);
+    }
+
     template<Color Perspective>
     void hint_common_access_for_perspective(const Position&                           pos,
+                                            AccumulatorStack&                         stack,
                                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
 
         // Works like update_accumulator, but performs less work.
@@ -833,37 +1019,56 @@ class FeatureTransformer {
         // Look for a usable accumulator of an earlier position. We keep track
         // of the estimated gain in terms of features to be added/subtracted.
         // Fast early exit.
-        if ((pos.state()->*accPtr).computed[Perspective])
+        if ((stack.latest().*accPtr).computed[Perspective])
             return;
 
-        StateInfo* oldest = try_find_computed_accumulator<Perspective>(pos);
+        const std::size_t oldest = try_find_computed_accumulator<Perspective>(pos, stack, cache);
 
-        if ((oldest->*accPtr).computed[Perspective] && oldest != pos.state())
-            update_accumulator_incremental<Perspective, true>(pos, oldest);
+        if ((stack[oldest].*accPtr).computed[Perspective] && oldest != stack.size() - 1)
+            update_accumulator_incremental<Perspective, true>(pos, stack, oldest);
         else
-            update_accumulator_refresh_cache<Perspective>(pos, cache);
+            update_accumulator_refresh_cache<Perspective>(pos, stack, cache);
     }
 
     template<Color Perspective>
     void update_accumulator(const Position&                           pos,
+                            AccumulatorStack&                         stack,
                             AccumulatorCaches::Cache<HalfDimensions>* cache) const {
 
-        StateInfo* oldest = try_find_computed_accumulator<Perspective>(pos);
+        const std::size_t latest = stack.size() - 1;
+
+        if ((stack[latest].*accPtr).computed[Perspective])
+            return;
 
-        if ((oldest->*accPtr).computed[Perspective] && oldest != pos.state())
+        const std::size_t oldest = try_find_computed_accumulator<Perspective>(pos, stack, cache);
+
+        if (!(stack[oldest].*accPtr).computed[Perspective])
+            update_accumulator_refresh_cache<Perspective>(pos, stack, cache);
+        else
             // Start from the oldest computed accumulator, update all the
-            // accumulators up to the current position.
-            update_accumulator_incremental<Perspective, false>(pos, oldest);
+            // accumulators up to the current position. The plies in between
+            // are caught up too, even along lines evaluated only by the other
+            // network, as their siblings are likely to start from them.
+            update_accumulator_incremental<Perspective, false>(pos, stack, oldest);
+    }
+
+#ifdef VECTOR
+    // Loads the k-th vector of the weight column part starting at offset
+    vec_t weight_vec(IndexType offset, IndexType k) const {
+        if constexpr (Int8Weights)
+            return vec_load_8_to_16(&weights[offset + k * (sizeof(vec_t) / sizeof(BiasType))]);
         else
-            update_accumulator_refresh_cache<Perspective>(pos, cache);
+            return vec_load(reinterpret_cast<const vec_t*>(&weights[offset]) + k);
     }
+#endif
 
     template<IndexType Size>
     friend struct AccumulatorCaches::Cache;
 
     alignas(CacheLineSize) BiasType biases[HalfDimensions];
-    alignas(CacheLineSize) WeightType weights[HalfDimensions * InputDimensions];
+    alignas(CacheLineSize) StoredWeightType weights[HalfDimensions * InputDimensions];
     alignas(CacheLineSize) PSQTWeightType psqtWeights[InputDimensions * PSQTBuckets];
+    int weightShift = 0;
 };
 
 }  // namespace Judas::Eval::NNUE
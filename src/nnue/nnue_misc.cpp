@@ -20,17 +20,21 @@
 
 #include "nnue_misc.h"
 
+#include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <cstring>
+#include <deque>
 #include <iomanip>
 #include <iosfwd>
 #include <iostream>
+#include <memory>
 #include <sstream>
 #include <string_view>
 #include <tuple>
 
 #include "../evaluate.h"
+#include "../movegen.h"
 #include "../position.h"
 #include "../types.h"
 #include "../uci.h"
@@ -45,11 +49,22 @@ constexpr std::string_view PieceToChar(" PNBRQK  pnbrqk");
 
 void hint_common_parent_position(const Position&    pos,
                                  const Networks&    networks,
+                                 AccumulatorStack&  accumulators,
                                  AccumulatorCaches& caches) {
     if (Eval::use_smallnet(pos))
-        networks.small.hint_common_access(pos, &caches.small);
+        networks.small.hint_common_access(pos, accumulators, &caches.small);
     else
-        networks.big.hint_common_access(pos, &caches.big);
+        networks.big.hint_common_access(pos, accumulators, &caches.big);
+}
+
+void prefetch_move(const Position&    pos,
+                   Move               m,
+                   const Networks&    networks,
+                   AccumulatorCaches& caches) {
+    if (Eval::use_smallnet(pos))
+        networks.small.prefetch_move(pos, m, &caches.small);
+    else
+        networks.big.prefetch_move(pos, m, &caches.big);
 }
 
 namespace {
@@ -106,7 +121,10 @@ void format_cp_aligned_dot(Value v, std::stringstream& stream, const Position& p
 // Returns a string with the value of each piece on a board,
 // and a table for (PSQT, Layers) values bucket by bucket.
 std::string
-trace(Position& pos, const Eval::NNUE::Networks& networks, Eval::NNUE::AccumulatorCaches& caches) {
+trace(Position&                      pos,
+      const Eval::NNUE::Networks&    networks,
+      Eval::NNUE::AccumulatorStack&  accumulators,
+      Eval::NNUE::AccumulatorCaches& caches) {
 
     std::stringstream ss;
 
@@ -132,7 +150,10 @@ trace(Position& pos, const Eval::NNUE::Networks& networks, Eval::NNUE::Accumulat
 
     // We estimate the value of each piece by doing a differential evaluation from
     // the current base eval, simulating the removal of the piece from its square.
-    auto [psqt, positional] = networks.big.evaluate(pos, &caches.big);
+    // The position is modified in place, so every evaluation starts from
+    // a freshly reset accumulator stack.
+    accumulators.reset();
+    auto [psqt, positional] = networks.big.evaluate(pos, accumulators, &caches.big);
     Value base              = psqt + positional;
     base                    = pos.side_to_move() == WHITE ? base : -base;
 
@@ -145,18 +166,15 @@ trace(Position& pos, const Eval::NNUE::Networks& networks, Eval::NNUE::Accumulat
 
             if (pc != NO_PIECE && type_of(pc) != KING)
             {
-                auto st = pos.state();
-
                 pos.remove_piece(sq);
-                st->accumulatorBig.computed[WHITE] = st->accumulatorBig.computed[BLACK] = false;
+                accumulators.reset();
 
-                std::tie(psqt, positional) = networks.big.evaluate(pos, &caches.big);
+                std::tie(psqt, positional) = networks.big.evaluate(pos, accumulators, &caches.big);
                 Value eval                 = psqt + positional;
                 eval                       = pos.side_to_move() == WHITE ? eval : -eval;
                 v                          = base - eval;
 
                 pos.put_piece(pc, sq);
-                st->accumulatorBig.computed[WHITE] = st->accumulatorBig.computed[BLACK] = false;
             }
 
             writeSquare(f, r, pc, v);
@@ -167,7 +185,8 @@ trace(Position& pos, const Eval::NNUE::Networks& networks, Eval::NNUE::Accumulat
         ss << board[row] << '\n';
     ss << '\n';
 
-    auto t = networks.big.trace_evaluate(pos, &caches.big);
+    accumulators.reset();
+    auto t = networks.big.trace_evaluate(pos, accumulators, &caches.big);
 
     ss << " NNUE network contributions "
        << (pos.side_to_move() == WHITE ? "(White to move)" : "(Black to move)") << std::endl
@@ -200,4 +219,200 @@ trace(Position& pos, const Eval::NNUE::Networks& networks, Eval::NNUE::Accumulat
 }
 
 
+namespace {
+
+// A position of the benchmark games, reached either by a move from the
+// previous one or, at the start of a game, by setting up its FEN.
+struct ReplayStep {
+    std::string fen;
+    Move        move;
+};
+
+// Looks for a sequence of at most two legal moves from pos to the position
+// with the given key. The position is left unchanged.
+bool find_link(Position& pos, Key target, int depth, std::vector<Move>& link) {
+
+    for (const auto& m : MoveList<LEGAL>(pos))
+    {
+        StateInfo st;
+        pos.do_move(m, st);
+        link.push_back(m);
+
+        const bool found =
+          pos.key() == target || (depth > 1 && find_link(pos, target, depth - 1, link));
+
+        pos.undo_move(m);
+        if (found)
+            return true;
+
+        link.pop_back();
+    }
+
+    return false;
+}
+
+// Links the consecutive positions of each game, which are usually a full
+// move apart, by the legal moves between them, restarting from the FEN where
+// there are no such moves.
+std::vector<ReplayStep> replay_steps(const std::vector<std::vector<std::string>>& games) {
+
+    std::vector<ReplayStep> steps;
+
+    for (const auto& game : games)
+    {
+        StateListPtr states(new std::deque<StateInfo>(1));
+        Position     pos;
+        bool         started = false;
+
+        for (const auto& fen : game)
+        {
+            StateInfo st;
+            Position  next;
+            next.set(fen, false, &st);
+
+            std::vector<Move> link;
+            if (started && find_link(pos, next.key(), 2, link))
+                for (Move m : link)
+                {
+                    states->emplace_back();
+                    pos.do_move(m, states->back());
+                    steps.push_back({"", m});
+                }
+            else
+            {
+                states = StateListPtr(new std::deque<StateInfo>(1));
+                pos.set(fen, false, &states->back());
+                steps.push_back({fen, Move::none()});
+            }
+
+            started = true;
+        }
+    }
+
+    return steps;
+}
+
+}  // namespace
+
+
+std::string benchmark(const Networks&                              networks,
+                      const std::vector<std::vector<std::string>>& games,
+                      int                                          passes) {
+
+    const auto steps        = replay_steps(games);
+    auto       accumulators = std::make_unique<AccumulatorStack>();
+    auto       caches       = std::make_unique<AccumulatorCaches>(networks);
+
+    std::stringstream ss;
+    ss << "NNUE benchmark: " << steps.size() << " positions, " << passes << " passes\n";
+
+    auto run = [&](const auto& network, auto& cache, const std::string& name) {
+        StageTimer timer;
+
+        const auto startTime  = std::chrono::steady_clock::now();
+        const auto startTicks = StageTimer::now();
+
+        for (int pass = 0; pass < passes; ++pass)
+        {
+            // The games are replayed move by move, so that the accumulators
+            // are updated incrementally as in a search...
+            StateListPtr states;
+            Position     pos;
+
+            for (const auto& step : steps)
+            {
+                NetworkStage updateStage = NetworkStage::Incremental;
+
+                if (step.move)
+                {
+                    states->emplace_back();
+                    pos.do_move(step.move, states->back());
+
+                    if (accumulators->size() < AccumulatorStack::MaxSize)
+                        accumulators->push(states->back().dirtyPiece);
+                    else
+                    {
+                        accumulators->reset();
+                        updateStage = NetworkStage::Refresh;
+                    }
+                }
+                else
+                {
+                    states = StateListPtr(new std::deque<StateInfo>(1));
+                    pos.set(step.fen, false, &states->back());
+                    accumulators->reset();
+                    updateStage = NetworkStage::Refresh;
+                }
+
+                network.evaluate_timed(pos, *accumulators, &cache, timer, updateStage);
+            }
+
+            // ...and then each position is refreshed from the cache
+            for (const auto& step : steps)
+            {
+                if (step.move)
+                {
+                    states->emplace_back();
+                    pos.do_move(step.move, states->back());
+                }
+                else
+                {
+                    states = StateListPtr(new std::deque<StateInfo>(1));
+                    pos.set(step.fen, false, &states->back());
+                }
+
+                accumulators->reset();
+                network.evaluate_timed(pos, *accumulators, &cache, timer, NetworkStage::Refresh);
+            }
+        }
+
+        const auto          elapsed = std::chrono::steady_clock::now() - startTime;
+        const std::uint64_t ticks   = std::max<std::uint64_t>(StageTimer::now() - startTicks, 1);
+        const double        nsPerTick =
+          double(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count())
+          / double(ticks);
+
+        constexpr std::pair<NetworkStage, const char*> Stages[] = {
+          {NetworkStage::Incremental, "incremental update"},
+          {NetworkStage::Refresh, "refresh from cache"},
+          {NetworkStage::Transform, "transform"},
+          {NetworkStage::SparseAffine, "sparse affine"},
+          {NetworkStage::DenseAffine, "dense affine"},
+          {NetworkStage::Activation, "activations"}};
+
+        ss << '\n'
+           << std::left << std::setw(24) << name << std::right << std::setw(12) << "ns/call"
+           << std::setw(14) << "Mcalls/s" << std::setw(12) << "calls" << '\n';
+
+        double totalNs = 0;
+        for (const auto& [stage, stageName] : Stages)
+        {
+            const std::uint64_t calls   = timer.calls[int(stage)];
+            const double        ns      = double(timer.ticks[int(stage)]) * nsPerTick;
+            const double        perCall = calls ? ns / double(calls) : 0.0;
+
+            totalNs += ns;
+            ss << "  " << std::left << std::setw(22) << stageName << std::right << std::fixed
+               << std::setprecision(1) << std::setw(12) << perCall << std::setw(14)
+               << std::setprecision(2) << (perCall > 0 ? 1000.0 / perCall : 0.0) << std::setw(12)
+               << calls << '\n';
+        }
+
+        const std::uint64_t evals   = timer.calls[int(NetworkStage::Transform)];
+        const double        perEval = evals ? totalNs / double(evals) : 0.0;
+        ss << "  " << std::left << std::setw(22) << "total per eval" << std::right
+           << std::setprecision(1) << std::setw(12) << perEval << std::setw(14)
+           << std::setprecision(2) << (perEval > 0 ? 1000.0 / perEval : 0.0) << std::setw(12)
+           << evals << '\n';
+    };
+
+    run(networks.big, caches->big,
+        "Big net (" + std::to_string(TransformedFeatureDimensionsBig) + ")");
+    run(networks.small, caches->small,
+        "Small net (" + std::to_string(TransformedFeatureDimensionsSmall) + ")");
+
+    return ss.str();
+}
+
+
 }  // namespace Judas::Eval::NNUE
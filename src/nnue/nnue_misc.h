@@ -19,8 +19,11 @@
 #ifndef NNUE_MISC_H_INCLUDED
 #define NNUE_MISC_H_INCLUDED
 
+#include <chrono>
 #include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
 
 #include "../types.h"
 #include "nnue_architecture.h"
@@ -50,13 +53,59 @@ struct NnueEvalTrace {
     std::size_t correctBucket;
 };
 
+// Accumulates the time spent in each stage of the evaluations timed by
+// nnuebench. Times are kept in ticks of the cheapest clock available, which
+// the caller converts to nanoseconds with a ratio measured over the run.
+class StageTimer {
+   public:
+    static std::uint64_t now() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+        return __builtin_ia32_rdtsc();
+#else
+        return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    void start() { last = now(); }
+
+    // Called at the end of each stage, also as the probe of propagate()
+    void operator()(NetworkStage stage) {
+        const std::uint64_t t = now();
+        ticks[int(stage)] += t - last;
+        last = t;
+    }
+
+    void count(NetworkStage stage) { ++calls[int(stage)]; }
+
+    std::uint64_t ticks[int(NetworkStage::Count)] = {};
+    std::uint64_t calls[int(NetworkStage::Count)] = {};
+
+   private:
+    std::uint64_t last = 0;
+};
+
 struct Networks;
 struct AccumulatorCaches;
+class AccumulatorStack;
 
-std::string trace(Position& pos, const Networks& networks, AccumulatorCaches& caches);
+std::string trace(Position&          pos,
+                  const Networks&    networks,
+                  AccumulatorStack&  accumulators,
+                  AccumulatorCaches& caches);
 void        hint_common_parent_position(const Position&    pos,
                                         const Networks&    networks,
+                                        AccumulatorStack&  accumulators,
                                         AccumulatorCaches& caches);
+void        prefetch_move(const Position&    pos,
+                          Move               m,
+                          const Networks&    networks,
+                          AccumulatorCaches& caches);
+
+// Replays the given games, each a list of consecutive positions, through both
+// networks and reports the time spent in each stage of the evaluation
+std::string benchmark(const Networks&                              networks,
+                      const std::vector<std::vector<std::string>>& games,
+                      int                                          passes);
 
 }  // namespace Judas::Eval::NNUE
 }  // namespace Judas
@@ -19,49 +19,122 @@
 #ifndef PERFT_H_INCLUDED
 #define PERFT_H_INCLUDED
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
 
+#include "misc.h"
 #include "movegen.h"
 #include "position.h"
+#include "thread.h"
 #include "types.h"
 #include "uci.h"
 
 namespace Judas::Benchmark {
 
-// Utility to verify move generation. All the leaf nodes up
-// to the given depth are generated and counted, and the sum is returned.
-template<bool Root>
-uint64_t perft(Position& pos, Depth depth) {
+// Lock-free table of perft subtree counts, keyed by position key and depth.
+// The check word holds the key xor'ed with the data word, so an entry torn by
+// two racing writers fails the key check instead of returning a wrong count.
+class PerftTable {
+   public:
+    explicit PerftTable(size_t mbSize) :
+        entries(mbSize * 1024 * 1024 / sizeof(Entry)) {}
 
-    StateInfo st;
-    ASSERT_ALIGNED(&st, Eval::NNUE::CacheLineSize);
+    bool probe(Key key, Depth depth, uint64_t& nodes) const {
+        const Entry&   e    = entries[mul_hi64(key, entries.size())];
+        const uint64_t data = e.data.load(std::memory_order_relaxed);
+
+        if ((e.check.load(std::memory_order_relaxed) ^ data) != key
+            || Depth(data & 0xFF) != depth)
+            return false;
+
+        nodes = data >> 8;
+        return true;
+    }
+
+    void save(Key key, Depth depth, uint64_t nodes) {
+        Entry&         e    = entries[mul_hi64(key, entries.size())];
+        const uint64_t data = nodes << 8 | uint64_t(depth);
+
+        e.check.store(key ^ data, std::memory_order_relaxed);
+        e.data.store(data, std::memory_order_relaxed);
+    }
+
+   private:
+    struct Entry {
+        std::atomic<uint64_t> check{0}, data{0};
+    };
+
+    std::vector<Entry> entries;
+};
+
+// Utility to verify move generation. All the leaf nodes up to the given depth
+// are generated and counted, and the sum is returned. The last ply is only
+// counted, and subtrees of two plies or more go through the table if any.
+inline uint64_t perft(Position& pos, Depth depth, PerftTable* table) {
+
+    if (depth <= 1)
+        return count_legal(pos);
+
+    uint64_t nodes = 0;
 
-    uint64_t   cnt, nodes = 0;
-    const bool leaf = (depth == 2);
+    if (table && table->probe(pos.key(), depth, nodes))
+        return nodes;
+
+    StateInfo st;
 
     for (const auto& m : MoveList<LEGAL>(pos))
     {
-        if (Root && depth <= 1)
-            cnt = 1, nodes++;
-        else
-        {
-            pos.do_move(m, st);
-            cnt = leaf ? MoveList<LEGAL>(pos).size() : perft<false>(pos, depth - 1);
-            nodes += cnt;
-            pos.undo_move(m);
-        }
-        if (Root)
-            sync_cout << UCIEngine::move(m, pos.is_chess960()) << ": " << cnt << sync_endl;
+        pos.do_move(m, st);
+        nodes += perft(pos, depth - 1, table);
+        pos.undo_move(m);
     }
+
+    if (table)
+        table->save(pos.key(), depth, nodes);
+
     return nodes;
 }
 
-inline uint64_t perft(const std::string& fen, Depth depth, bool isChess960) {
+// Splits the root moves across the thread pool, each job setting up its own
+// copy of the root position and sharing the table if any. The per move counts
+// are printed in root move order.
+inline uint64_t perft(ThreadPool&        threads,
+                      const std::string& fen,
+                      Depth              depth,
+                      bool               isChess960,
+                      PerftTable*        table,
+                      bool               divide = true) {
     StateListPtr states(new std::deque<StateInfo>(1));
     Position     p;
     p.set(fen, isChess960, &states->back());
 
-    return perft<true>(p, depth);
+    const MoveList<LEGAL> moves(p);
+    std::vector<uint64_t> counts(moves.size(), 1);
+
+    if (depth > 1)
+        threads.run_parallel(moves.size(), [&](size_t i) {
+            StateInfo rootState, st;
+            Position  pos;
+            pos.set(fen, isChess960, &rootState);
+            pos.do_move(moves.begin()[i], st);
+            counts[i] = perft(pos, depth - 1, table);
+        });
+
+    uint64_t nodes = 0;
+
+    for (size_t i = 0; i < moves.size(); ++i)
+    {
+        nodes += counts[i];
+        if (divide)
+            sync_cout << UCIEngine::move(moves.begin()[i], isChess960) << ": " << counts[i]
+                      << sync_endl;
+    }
+
+    return nodes;
 }
 }
 
@@ -22,6 +22,7 @@
 #include <array>
 #include <cassert>
 #include <cctype>
+#include <charconv>
 #include <cstddef>
 #include <cstring>
 #include <initializer_list>
@@ -61,6 +62,9 @@ constexpr std::string_view PieceToChar(" PNBRQK  pnbrqk");
 
 constexpr Piece Pieces[] = {W_PAWN, W_KNIGHT, W_BISHOP, W_ROOK, W_QUEEN, W_KING,
                             B_PAWN, B_KNIGHT, B_BISHOP, B_ROOK, B_QUEEN, B_KING};
+
+// Packed codes of the rooks that keep a castling right, unused by Piece
+constexpr uint8_t CastlingRookCode[COLOR_NB] = {7, 15};
 }  // namespace
 
 
@@ -87,7 +91,6 @@ std::ostream& operator<<(std::ostream& os, const Position& pos) {
     if (int(Tablebases::MaxCardinality) >= popcount(pos.pieces()) && !pos.can_castle(ANY_CASTLING))
     {
         StateInfo st;
-        ASSERT_ALIGNED(&st, Eval::NNUE::CacheLineSize);
 
         Position p;
         p.set(pos.fen(), pos.is_chess960(), &st);
@@ -941,7 +944,7 @@ void Position::init() {
 // Initializes the position object with the given FEN string.
 // This function is not very robust - make sure that input FENs are correct,
 // this is assumed to be the responsibility of the GUI.
-Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si) {
+Position& Position::set(std::string_view fenStr, bool isChess960, StateInfo* si) {
     /*
    A FEN string defines a particular position using only the ASCII character set.
 
@@ -977,19 +980,30 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si) {
       incremented after Black's move.
 */
 
-    unsigned char      col, row, token;
-    size_t             idx;
-    Square             sq = SQ_A8;
-    std::istringstream ss(fenStr);
+    unsigned char col, row, token = 0;
+    size_t        idx, i = 0;
+    Square        sq = SQ_A8;
+
+    // Reads the next character, whitespace included
+    const auto next = [&](unsigned char& c) {
+        return i < fenStr.size() ? (c = fenStr[i++], true) : false;
+    };
+
+    // Reads a number after optional whitespace, leaves n untouched if none
+    const auto number = [&](int& n) {
+        while (i < fenStr.size() && isspace((unsigned char) fenStr[i]))
+            ++i;
+        auto [end, ec] = std::from_chars(fenStr.data() + i, fenStr.data() + fenStr.size(), n);
+        i              = size_t(end - fenStr.data());
+        return ec == std::errc();
+    };
 
     std::memset(this, 0, sizeof(Position));
     std::memset(si, 0, sizeof(StateInfo));
     st = si;
 
-    ss >> std::noskipws;
-
     // 1. Piece placement
-    while ((ss >> token) && !isspace(token))
+    while (next(token) && !isspace(token))
     {
         if (isdigit(token))
             sq += (token - '0') * EAST;  // Advance the given number of files
@@ -1005,16 +1019,16 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si) {
     }
 
     // 2. Active color
-    ss >> token;
+    next(token);
     sideToMove = (token == 'w' ? WHITE : BLACK);
-    ss >> token;
+    next(token);
 
     // 3. Castling availability. Compatible with 3 standards: Normal FEN standard,
     // Shredder-FEN that uses the letters of the columns on which the rooks began
     // the game instead of KQkq and also X-FEN standard that, in case of Chess960,
     // if an inner rook is associated with the castling right, the castling tag is
     // replaced by the file letter of the involved rook, as for the Shredder-FEN.
-    while ((ss >> token) && !isspace(token))
+    while (next(token) && !isspace(token))
     {
         Square rsq;
         Color  c    = islower(token) ? BLACK : WHITE;
@@ -1043,8 +1057,8 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si) {
     // Ignore if square is invalid or not on side to move relative rank 6.
     bool enpassant = false;
 
-    if (((ss >> col) && (col >= 'a' && col <= 'h'))
-        && ((ss >> row) && (row == (sideToMove == WHITE ? '6' : '3'))))
+    if ((next(col) && (col >= 'a' && col <= 'h'))
+        && (next(row) && (row == (sideToMove == WHITE ? '6' : '3'))))
     {
         st->epSquare = make_square(File(col - 'a'), Rank(row - '1'));
 
@@ -1061,7 +1075,8 @@ Position& Position::set(const string& fenStr, bool isChess960, StateInfo* si) {
         st->epSquare = SQ_NONE;
 
     // 5-6. Halfmove clock and fullmove number
-    ss >> std::skipws >> st->rule50 >> gamePly;
+    if (number(st->rule50))
+        number(gamePly);
 
     // Convert from fullmove starting from 1 to gamePly starting from 0,
     // handle also common incorrect FEN with fullmove = 0.
@@ -1241,6 +1256,135 @@ string Position::fen() const {
     return ss.str();
 }
 
+// Writes the packed form of the position, see PackedPosition. Returns false,
+// leaving packed untouched, for positions that unpack() would refuse: more
+// than 32 pieces, not exactly one king per side, a pawn on the first or last
+// rank, or the side not to move in check.
+bool Position::pack(PackedPosition& packed) const {
+
+    Bitboard occupied      = pieces();
+    Bitboard castlingRooks = 0;
+
+    if (popcount(occupied) > 32 || count<KING>(WHITE) != 1 || count<KING>(BLACK) != 1
+        || (pieces(PAWN) & (Rank1BB | Rank8BB))
+        || (attackers_to(square<KING>(~sideToMove)) & pieces(sideToMove)))
+        return false;
+
+    packed = PackedPosition{};
+
+    for (CastlingRights cr : {WHITE_OO, WHITE_OOO, BLACK_OO, BLACK_OOO})
+        if (can_castle(cr))
+            castlingRooks |= castling_rook_square(cr);
+
+    for (int i = 0; i < 8; ++i)
+        packed.data[i] = uint8_t(occupied >> (8 * i));
+
+    for (int n = 0; occupied; ++n)
+    {
+        Square  s    = pop_lsb(occupied);
+        uint8_t code = castlingRooks & s ? CastlingRookCode[color_of(piece_on(s))]
+                                         : uint8_t(piece_on(s));
+
+        packed.data[8 + n / 2] |= uint8_t(code << (4 * (n % 2)));
+    }
+
+    const int rule50 = std::min(st->rule50, 0xFFFF);
+
+    packed.data[24] = uint8_t(sideToMove);
+    packed.data[25] = uint8_t(st->epSquare);
+    packed.data[26] = uint8_t(rule50);
+    packed.data[27] = uint8_t(rule50 >> 8);
+    packed.data[28] = uint8_t(gamePly);
+    packed.data[29] = uint8_t(gamePly >> 8);
+
+    return true;
+}
+
+
+// Initializes the position object from its packed form, the counterpart of
+// pack() as set() is of fen(). The record may come from another process or an
+// old file, so it is checked as it is read. Returns false, leaving the position
+// unusable, if it holds more than 32 pieces, a piece code that is no piece, not
+// exactly one king per side, a pawn on the first or last rank, a castling rook
+// that is not on its king's back rank or shares a side of the king with
+// another, the side not to move in check, or an en passant square that set()
+// would not accept.
+bool Position::unpack(const PackedPosition& packed, bool isChess960, StateInfo* si) {
+
+    Bitboard occupied = 0, castlingRooks = 0;
+
+    for (int i = 0; i < 8; ++i)
+        occupied |= Bitboard(packed.data[i]) << (8 * i);
+
+    if (popcount(occupied) > 32)
+        return false;
+
+    std::memset(this, 0, sizeof(Position));
+    std::memset(si, 0, sizeof(StateInfo));
+    st = si;
+
+    for (int n = 0; occupied; ++n)
+    {
+        Square  s    = pop_lsb(occupied);
+        uint8_t code = (packed.data[8 + n / 2] >> (4 * (n % 2))) & 0xF;
+
+        // Codes 0 and 8 are NO_PIECE and the unused piece of type 0 for black
+        if ((code & 7) == 0)
+            return false;
+
+        if (code == CastlingRookCode[WHITE] || code == CastlingRookCode[BLACK])
+        {
+            castlingRooks |= s;
+            code = make_piece(code == CastlingRookCode[WHITE] ? WHITE : BLACK, ROOK);
+        }
+
+        put_piece(Piece(code), s);
+    }
+
+    if (count<KING>(WHITE) != 1 || count<KING>(BLACK) != 1
+        || (pieces(PAWN) & (Rank1BB | Rank8BB)))
+        return false;
+
+    while (castlingRooks)
+    {
+        Square         s   = pop_lsb(castlingRooks);
+        Color          c   = color_of(piece_on(s));
+        Square         ksq = square<KING>(c);
+        CastlingRights cr  = c & (ksq < s ? KING_SIDE : QUEEN_SIDE);
+
+        if (relative_rank(c, s) != RANK_1 || rank_of(ksq) != rank_of(s) || can_castle(cr))
+            return false;
+
+        set_castling_right(c, s);
+    }
+
+    sideToMove   = Color(packed.data[24] & 1);
+    st->epSquare = packed.data[25] < SQUARE_NB ? Square(packed.data[25]) : SQ_NONE;
+    st->rule50   = packed.data[26] | packed.data[27] << 8;
+    gamePly      = packed.data[28] | packed.data[29] << 8;
+
+    if (attackers_to(square<KING>(~sideToMove)) & pieces(sideToMove))
+        return false;
+
+    // Same conditions as in set(), the rank is tested first to keep the
+    // squares next to the en passant square on the board
+    const Square ep = st->epSquare;
+
+    if (ep != SQ_NONE
+        && !(relative_rank(sideToMove, ep) == RANK_6
+             && (pawn_attacks_bb(~sideToMove, ep) & pieces(sideToMove, PAWN))
+             && (pieces(~sideToMove, PAWN) & (ep + pawn_push(~sideToMove)))
+             && !(pieces() & (ep | (ep + pawn_push(sideToMove))))))
+        return false;
+
+    chess960 = isChess960;
+    set_state();
+
+    assert(pos_is_ok());
+
+    return true;
+}
+
 // Calculates st->blockersForKing[c] and st->pinners[~c],
 // which store respectively the pieces preventing king of color c from being in check
 // and the slider pieces of color ~c pinning pieces of color c to the king.
@@ -1495,7 +1639,6 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
     // our state pointer to point to the new (ready to be updated) state.
     std::memcpy(&newSt, st, offsetof(StateInfo, key));
     newSt.previous = st;
-    st->next       = &newSt;
     st             = &newSt;
 
     // Increment ply counters. In particular, rule50 will be reset to zero later on
@@ -1505,9 +1648,6 @@ void Position::do_move(Move m, StateInfo& newSt, bool givesCheck) {
     ++st->pliesFromNull;
 
     // Used by NNUE
-    st->accumulatorBig.computed[WHITE]     = st->accumulatorBig.computed[BLACK] =
-      st->accumulatorSmall.computed[WHITE] = st->accumulatorSmall.computed[BLACK] = false;
-
     auto& dp     = st->dirtyPiece;
     dp.dirty_num = 1;
 
@@ -1820,16 +1960,13 @@ void Position::do_null_move(StateInfo& newSt, const TranspositionTable& tt) {
     assert(!checkers());
     assert(&newSt != st);
 
-    std::memcpy(&newSt, st, offsetof(StateInfo, accumulatorBig));
+    std::memcpy(&newSt, st, offsetof(StateInfo, dirtyPiece));
 
     newSt.previous = st;
-    st->next       = &newSt;
     st             = &newSt;
 
-    st->dirtyPiece.dirty_num               = 0;
-    st->dirtyPiece.piece[0]                = NO_PIECE;  // Avoid checks in UpdateAccumulator()
-    st->accumulatorBig.computed[WHITE]     = st->accumulatorBig.computed[BLACK] =
-      st->accumulatorSmall.computed[WHITE] = st->accumulatorSmall.computed[BLACK] = false;
+    st->dirtyPiece.dirty_num = 0;
+    st->dirtyPiece.piece[0]  = NO_PIECE;  // Avoid checks in UpdateAccumulator()
 
     if (st->epSquare != SQ_NONE)
     {
@@ -1988,7 +2125,7 @@ bool Position::see_ge(Move m, int threshold) const {
 // or by repetition. It does not detect stalemates.
 bool Position::is_draw(int ply) const {
 
-    if (st->rule50 > 99 && (!checkers() || MoveList<LEGAL>(*this).size()))
+    if (st->rule50 > 99 && (!checkers() || count_legal(*this)))
         return true;
 
     // Return a draw score if a position repeats once earlier but strictly
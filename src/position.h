@@ -20,14 +20,14 @@
 #define POSITION_H_INCLUDED
 
 #include <cassert>
+#include <cstdint>
 #include <deque>
 #include <iosfwd>
 #include <memory>
 #include <string>
+#include <string_view>
 
 #include "bitboard.h"
-#include "nnue/nnue_accumulator.h"
-#include "nnue/nnue_architecture.h"
 #include "types.h"
 
 namespace Judas {
@@ -58,17 +58,14 @@ struct StateInfo {
     Key        key;
     Bitboard   checkersBB;
     StateInfo* previous;
-    StateInfo* next;
     Bitboard   blockersForKing[COLOR_NB];
     Bitboard   pinners[COLOR_NB];
     Bitboard   checkSquares[PIECE_TYPE_NB];
     Piece      capturedPiece;
     int        repetition;
 
-    // Used by NNUE
-    Eval::NNUE::Accumulator<Eval::NNUE::TransformedFeatureDimensionsBig>   accumulatorBig;
-    Eval::NNUE::Accumulator<Eval::NNUE::TransformedFeatureDimensionsSmall> accumulatorSmall;
-    DirtyPiece                                                             dirtyPiece;
+    // Used by NNUE, copied to the accumulator stack of the searching thread
+    DirtyPiece dirtyPiece;
 };
 
 
@@ -79,6 +76,17 @@ struct StateInfo {
 using StateListPtr = std::unique_ptr<std::deque<StateInfo>>;
 
 
+// PackedPosition is the fixed-size binary form of a position, for storage and
+// exchange. Bytes 0-7 hold the occupied squares, bytes 8-23 a 4-bit piece code
+// per occupied square from a1 upwards, then come the side to move, the en
+// passant square, the rule50 counter and the game ply, little endian. The piece
+// codes are the Piece values, and rooks keeping a castling right get 7 (white)
+// or 15 (black), so that Chess960 castling survives the round trip.
+struct PackedPosition {
+    uint8_t data[32];
+};
+
+
 // Position class stores information regarding the board representation as
 // pieces, side to move, hash keys, castling info, etc. Important methods are
 // do_move() and undo_move(), used by the search to update node info when
@@ -98,10 +106,14 @@ class Position {
     bool is_on_seventh_rank(Square s, Color c) const; // Rook on the seventh rank
 
     // FEN string input/output
-    Position&   set(const std::string& fenStr, bool isChess960, StateInfo* si);
+    Position&   set(std::string_view fenStr, bool isChess960, StateInfo* si);
     Position&   set(const std::string& code, Color c, StateInfo* si);
     std::string fen() const;
 
+    // Packed binary input/output
+    bool unpack(const PackedPosition& packed, bool isChess960, StateInfo* si);
+    bool pack(PackedPosition& packed) const;
+
     // Position representation
     Bitboard pieces(PieceType pt = ALL_PIECES) const;
     template<typename... PieceTypes>
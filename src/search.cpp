@@ -67,11 +67,12 @@ std::vector<QLearningMove> qLearningTrajectory;
 
 namespace TB = Tablebases;
 
-void syzygy_extend_pv(const OptionsMap&            options,
-                      const Search::LimitsType&    limits,
-                      Judas::Position&         pos,
-                      Judas::Search::RootMove& rootMove,
-                      Value&                       v);
+void syzygy_extend_pv(const OptionsMap&              options,
+                      const Search::LimitsType&      limits,
+                      Judas::Position&               pos,
+                      Judas::Search::RootMove&       rootMove,
+                      Value&                         v,
+                      const Tablebases::ParallelFor& tbParallel);
 
 using namespace Search;
 
@@ -213,6 +214,7 @@ void Search::Worker::start_searching() {
     // Non-main threads go directly to iterative_deepening()
     if (!is_mainthread())
     {
+        wakeupLatency = std::chrono::steady_clock::now() - threads.wakeup.startTime;
         iterative_deepening();
         return;
     }
@@ -442,9 +444,13 @@ if (!bookMove)
     }
 }
 
-    // Send again PV info if we have a new best thread
+    // Send again PV info if we have a new best thread. The other threads are
+    // idle by now and can help ranking the moves along a tablebase PV.
     if (bestThread != this)
-        main_manager()->pv(*bestThread, threads, tt, bestThread->completedDepth);
+        main_manager()->pv(*bestThread, threads, tt, bestThread->completedDepth,
+                           [this](size_t count, const std::function<void(size_t)>& job) {
+                               threads.run_parallel(count, job, 1);
+                           });
 
     std::string ponder;
 
@@ -479,18 +485,69 @@ if (!bookMove)
     }
 }
 
+void Search::Worker::batch_search(size_t              index,
+                                  const std::string&  fen,
+                                  const LimitsType&   batchLimits,
+                                  const UpdateBatch&  onResult) {
+
+    rootPos.set(fen, options["UCI_Chess960"], &rootState);
+
+    limits = batchLimits;
+    nodes = tbHits = nmpMinPly = bestMoveChanges = 0;
+    rootDepth = completedDepth = 0;
+
+    rootMoves.clear();
+    for (const auto& m : MoveList<LEGAL>(rootPos))
+        rootMoves.emplace_back(m);
+
+    if (rootMoves.empty())
+    {
+        onResult({{0, {rootPos.checkers() ? -VALUE_MATE : VALUE_DRAW, rootPos}}, index, 0, "0000", ""});
+        return;
+    }
+
+    tbConfig = Tablebases::rank_root_moves(options, rootPos, rootMoves);
+
+    batchSearch = true;
+    batchStop   = false;
+    iterative_deepening();
+    batchSearch = false;
+
+    const RootMove& rm = rootMoves[0];
+
+    Value v = rm.score != -VALUE_INFINITE ? rm.uciScore : rm.previousScore;
+    if (v == -VALUE_INFINITE)
+        v = VALUE_ZERO;
+    if (tbConfig.rootInTB && std::abs(v) <= VALUE_TB)
+        v = rm.tbScore;
+
+    std::string pv;
+    for (Move m : rm.pv)
+        pv += UCIEngine::move(m, rootPos.is_chess960()) + " ";
+
+    if (!pv.empty())
+        pv.pop_back();
+
+    const auto bestmove = UCIEngine::move(rm.pv[0], rootPos.is_chess960());
+
+    onResult({{completedDepth, {v, rootPos}}, index, size_t(nodes), bestmove, pv});
+}
+
 // Main iterative deepening loop. It calls search()
 // repeatedly with increasing depth until the allocated thinking time has been
 // consumed, the user stops the search, or the maximum search depth is reached.
 void Search::Worker::iterative_deepening() {
 
-    SearchManager* mainThread = (is_mainthread() ? main_manager() : nullptr);
+    // During a batch analysis the main thread searches its own root like the others
+    SearchManager* mainThread = (is_mainthread() && !batchSearch ? main_manager() : nullptr);
 
     Move pv[MAX_PLY + 1];
 
     Depth lastBestMoveDepth = 0;
     Value lastBestScore     = -VALUE_INFINITE;
-    auto  lastBestPV        = std::vector{Move::none()};
+    auto  lastBestPV        = RootMove(Move::none()).pv;
+
+    accumulatorStack.reset();
 
     Value  alpha, beta;
     Value  bestValue     = -VALUE_INFINITE;
@@ -540,8 +597,8 @@ void Search::Worker::iterative_deepening() {
     lowPlyHistory.fill(106);
 
     // Iterative deepening loop until requested to stop or the target depth is reached
-    while (++rootDepth < MAX_PLY && !threads.stop
-           && !(limits.depth && mainThread && rootDepth > limits.depth))
+    while (++rootDepth < MAX_PLY && !threads.stop && !batchStop
+           && !(limits.depth && (mainThread || batchSearch) && rootDepth > limits.depth))
     {
         // Age out PV variability metric
         if (mainThread)
@@ -606,7 +663,7 @@ void Search::Worker::iterative_deepening() {
                 // If search has been stopped, we break immediately. Sorting is
                 // safe because RootMoves is still valid, although it refers to
                 // the previous iteration.
-                if (threads.stop)
+                if (threads.stop || batchStop)
                     break;
 
                 // When failing high/low give some update before a re-search. To avoid
@@ -653,11 +710,11 @@ void Search::Worker::iterative_deepening() {
                 && !(threads.abortedSearch && is_loss(rootMoves[0].uciScore)))
                 main_manager()->pv(*this, threads, tt, rootDepth);
 
-            if (threads.stop)
+            if (threads.stop || batchStop)
                 break;
         }
 
-        if (!threads.stop)
+        if (!threads.stop && !batchStop)
             completedDepth = rootDepth;
 
         // We make sure not to pick an unproven mated-in score,
@@ -770,6 +827,8 @@ void Search::Worker::clear() {
     minorPieceCorrectionHistory.fill(0);
     nonPawnCorrectionHistory[WHITE].fill(0);
     nonPawnCorrectionHistory[BLACK].fill(0);
+    stats.clear();
+    tbCache.clear();
 
     for (auto& to : continuationCorrectionHistory)
         for (auto& h : to)
@@ -822,7 +881,6 @@ Value Search::Worker::search(
 
     Move      pv[MAX_PLY + 1];
     StateInfo st;
-    ASSERT_ALIGNED(&st, Eval::NNUE::CacheLineSize);
 
     Key   posKey;
     Move  move, excludedMove, bestMove,
@@ -851,9 +909,13 @@ Value Search::Worker::search(
     bestValue          = -VALUE_INFINITE;
     maxValue           = VALUE_INFINITE;
 
+    SEARCH_STAT(STAT_NODE, depth);
+
     // Check for the available remaining time
-    if (is_mainthread())
+    if (is_mainthread() && !batchSearch)
         main_manager()->check_time(*thisThread);
+    else if (batchSearch && limits.nodes && completedDepth >= 1 && nodes >= limits.nodes)
+        batchStop = true;
 
     // Used to send selDepth info to GUI (selDepth counts from 1, ply from 0)
     if (PvNode && thisThread->selDepth < ss->ply + 1)
@@ -862,7 +924,7 @@ Value Search::Worker::search(
     if (!rootNode)
     {
         // Step 2. Check for aborted search and immediate draw
-        if (threads.stop.load(std::memory_order_relaxed) || pos.is_draw(ss->ply)
+        if (threads.stop.load(std::memory_order_relaxed) || batchStop || pos.is_draw(ss->ply)
             || ss->ply >= MAX_PLY)
             return (ss->ply >= MAX_PLY && !ss->inCheck) ? evaluate(pos)
                                                         : value_draw(thisThread->nodes);
@@ -925,7 +987,10 @@ Value Search::Worker::search(
         // Partial workaround for the graph history interaction problem
         // For high rule50 counts don't produce transposition table cutoffs.
         if (pos.rule50_count() < 90)
+        {
+            SEARCH_STAT(STAT_TT_CUTOFF, depth);
             return ttData.value;
+        }
     }
 
     // Step 4Bis. Global Learning Table lookup
@@ -996,7 +1061,10 @@ Value Search::Worker::search(
                 // Partial workaround for the graph history interaction problem
                 // For high rule50 counts don't produce transposition table cutoffs.
                 if (pos.rule50_count() < 90)
+                {
+                    SEARCH_STAT(STAT_LEARNING_CUTOFF, depth);
                     return expTTValue;
+                }
             }
         }
     }
@@ -1010,8 +1078,19 @@ Value Search::Worker::search(
             && (piecesCount < tbConfig.cardinality || depth >= tbConfig.probeDepth)
             && pos.rule50_count() == 0 && !pos.can_castle(ANY_CASTLING))
         {
-            TB::ProbeState err;
-            TB::WDLScore   wdl = Tablebases::probe_wdl(pos, &err);
+            TB::ProbeState err = TB::ProbeState::OK;
+            TB::WDLScore   wdl;
+
+            // Positions probed before are answered by the thread's cache
+            if (!tbCache.probe(pos.key(), wdl))
+            {
+                wdl = Tablebases::probe_wdl(pos, &err);
+
+                if (err != TB::ProbeState::FAIL)
+                    tbCache.save(pos.key(), wdl);
+            }
+
+            SEARCH_STAT(STAT_TB_PROBE, depth);
 
             // Force check of time on the next occasion
             if (is_mainthread())
@@ -1040,6 +1119,7 @@ Value Search::Worker::search(
                                    std::min(MAX_PLY - 1, depth + 6), Move::none(), VALUE_NONE,
                                    tt.generation());
 
+                    SEARCH_STAT(STAT_TB_CUTOFF, depth);
                     return value;
                 }
 
@@ -1068,7 +1148,8 @@ Value Search::Worker::search(
     {
         // Providing the hint that this node's accumulator will be used often
         // brings significant Elo gain (~13 Elo).
-        Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken], refreshTable);
+        Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken], accumulatorStack,
+                                                refreshTable);
         unadjustedStaticEval = eval = ss->staticEval;
     }
     else if (ss->ttHit)
@@ -1078,7 +1159,8 @@ Value Search::Worker::search(
         if (!is_valid(unadjustedStaticEval))
             unadjustedStaticEval = evaluate(pos);
         else if (PvNode)
-            Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken], refreshTable);
+            Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken],
+                                                    accumulatorStack, refreshTable);
 
         ss->staticEval = eval = to_corrected_static_eval(unadjustedStaticEval, correctionValue);
 
@@ -1150,7 +1232,10 @@ Value Search::Worker::search(
     {
         value = qsearch<NonPV>(pos, ss, alpha - 1, alpha);
         if (value < alpha && !is_decisive(value))
+        {
+            SEARCH_STAT(STAT_RAZORING, depth);
             return value;
+        }
     }
 
     // Step 8. Futility pruning: child node (~40 Elo)
@@ -1161,7 +1246,10 @@ Value Search::Worker::search(
                + (ss->staticEval == eval) * (40 - std::abs(correctionValue) / 131072)
              >= beta
         && eval >= beta && (!ttData.move || ttCapture) && !is_loss(beta) && !is_win(eval))
+    {
+        SEARCH_STAT(STAT_FUTILITY, depth);
         return beta + (eval - beta) / 3;
+    }
 
     improving |= ss->staticEval >= beta + 100;
 
@@ -1180,17 +1268,20 @@ Value Search::Worker::search(
         ss->continuationHistory           = &thisThread->continuationHistory[0][0][NO_PIECE][0];
         ss->continuationCorrectionHistory = &thisThread->continuationCorrectionHistory[NO_PIECE][0];
 
-        pos.do_null_move(st, tt);
+        do_null_move(pos, st);
 
         Value nullValue = -search<NonPV>(pos, ss + 1, -beta, -beta + 1, depth - R, false);
 
-        pos.undo_null_move();
+        undo_null_move(pos);
 
         // Do not return unproven mate or TB scores
         if (nullValue >= beta && !is_win(nullValue))
         {
             if (thisThread->nmpMinPly || depth < 16)
+            {
+                SEARCH_STAT(STAT_NULL_MOVE, depth);
                 return nullValue;
+            }
 
             assert(!thisThread->nmpMinPly);  // Recursive verification is not allowed
 
@@ -1203,14 +1294,20 @@ Value Search::Worker::search(
             thisThread->nmpMinPly = 0;
 
             if (v >= beta)
+            {
+                SEARCH_STAT(STAT_NULL_MOVE, depth);
                 return nullValue;
+            }
         }
     }
 
     // Step 10. Internal iterative reductions (~9 Elo)
     // For PV nodes without a ttMove, we decrease depth.
     if (PvNode && !ttData.move)
+    {
+        SEARCH_STAT(STAT_IIR, depth);
         depth -= 3;
+    }
 
     // Use qsearch if depth <= 0
     if (depth <= 0)
@@ -1265,7 +1362,7 @@ Value Search::Worker::search(
               &this->continuationCorrectionHistory[pos.moved_piece(move)][move.to_sq()];
 
             thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
-            pos.do_move(move, st);
+            do_move(pos, move, st);
 
             // Perform a preliminary qsearch to verify that the move holds
             value = -qsearch<NonPV>(pos, ss + 1, -probCutBeta, -probCutBeta + 1);
@@ -1275,7 +1372,7 @@ Value Search::Worker::search(
                 value =
                   -search<NonPV>(pos, ss + 1, -probCutBeta, -probCutBeta + 1, depth - 4, !cutNode);
 
-            pos.undo_move(move);
+            undo_move(pos, move);
 
             if (value >= probCutBeta)
             {
@@ -1284,11 +1381,13 @@ Value Search::Worker::search(
                 // Save ProbCut data into transposition table
                 ttWriter.write(posKey, value_to_tt(value, ss->ply), ss->ttPv, BOUND_LOWER,
                                depth - 3, move, unadjustedStaticEval, tt.generation());
+                SEARCH_STAT(STAT_PROBCUT, depth);
                 return is_decisive(value) ? value : value - (probCutBeta - beta);
             }
         }
 
-        Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken], refreshTable);
+        Eval::NNUE::hint_common_parent_position(pos, networks[numaAccessToken], accumulatorStack,
+                                                refreshTable);
     }
 
 moves_loop:  // When in check, search starts here
@@ -1297,7 +1396,10 @@ moves_loop:  // When in check, search starts here
     probCutBeta = beta + 417;
     if ((ttData.bound & BOUND_LOWER) && ttData.depth >= depth - 4 && ttData.value >= probCutBeta
         && !is_decisive(beta) && is_valid(ttData.value) && !is_decisive(ttData.value))
+    {
+        SEARCH_STAT(STAT_SMALL_PROBCUT, depth);
         return probCutBeta;
+    }
 
     const PieceToHistory* contHist[] = {(ss - 1)->continuationHistory,
                                         (ss - 2)->continuationHistory,
@@ -1337,7 +1439,7 @@ moves_loop:  // When in check, search starts here
 
         ss->moveCount = ++moveCount;
 
-        if (rootNode && is_mainthread() && nodes > 10000000)
+        if (rootNode && is_mainthread() && !batchSearch && nodes > 10000000)
         {
             main_manager()->updates.onIter(
               {depth, UCIEngine::move(move, pos.is_chess960()), moveCount + thisThread->pvIdx});
@@ -1363,7 +1465,10 @@ moves_loop:  // When in check, search starts here
         {
             // Skip quiet moves if movecount exceeds our FutilityMoveCount threshold (~8 Elo)
             if (moveCount >= futility_move_count(improving, depth))
+            {
+                SEARCH_STAT(STAT_MOVE_COUNT_PRUNING, depth);
                 mp.skip_quiet_moves();
+            }
 
             // Reduced depth of the next LMR search
             int lmrDepth = newDepth - r / 1024;
@@ -1380,13 +1485,19 @@ moves_loop:  // When in check, search starts here
                     Value futilityValue = ss->staticEval + 287 + 253 * lmrDepth
                                         + PieceValue[capturedPiece] + captHist / 7;
                     if (futilityValue <= alpha)
+                    {
+                        SEARCH_STAT(STAT_CAPTURE_FUTILITY, depth);
                         continue;
+                    }
                 }
 
                 // SEE based pruning for captures and checks (~11 Elo)
                 int seeHist = std::clamp(captHist / 33, -161 * depth, 156 * depth);
                 if (!pos.see_ge(move, -162 * depth - seeHist))
+                {
+                    SEARCH_STAT(STAT_CAPTURE_SEE, depth);
                     continue;
+                }
             }
             else
             {
@@ -1397,7 +1508,10 @@ moves_loop:  // When in check, search starts here
 
                 // Continuation history based pruning (~2 Elo)
                 if (history < -3884 * depth)
+                {
+                    SEARCH_STAT(STAT_HISTORY_PRUNING, depth);
                     continue;
+                }
 
                 history += 2 * thisThread->mainHistory[us][move.from_to()];
 
@@ -1412,6 +1526,7 @@ moves_loop:  // When in check, search starts here
                     if (bestValue <= futilityValue && !is_decisive(bestValue)
                         && !is_win(futilityValue))
                         bestValue = futilityValue;
+                    SEARCH_STAT(STAT_PARENT_FUTILITY, depth);
                     continue;
                 }
 
@@ -1419,7 +1534,10 @@ moves_loop:  // When in check, search starts here
 
                 // Prune moves with negative SEE (~4 Elo)
                 if (!pos.see_ge(move, -25 * lmrDepth * lmrDepth))
+                {
+                    SEARCH_STAT(STAT_QUIET_SEE, depth);
                     continue;
+                }
             }
         }
 
@@ -1462,6 +1580,8 @@ moves_loop:  // When in check, search starts here
                               + (value < singularBeta - tripleMargin);
 
                     depth += ((!PvNode) && (depth < 14));
+
+                    SEARCH_STAT(STAT_SINGULAR_EXT, depth);
                 }
 
                 // Multi-cut pruning
@@ -1471,7 +1591,10 @@ moves_loop:  // When in check, search starts here
                 // singular (multiple moves fail high), and we can prune the whole
                 // subtree by returning a softbound.
                 else if (value >= beta && !is_decisive(value))
+                {
+                    SEARCH_STAT(STAT_MULTI_CUT, depth);
                     return value;
+                }
 
                 // Negative extensions
                 // If other moves failed high over (ttValue - margin) without the
@@ -1488,6 +1611,9 @@ moves_loop:  // When in check, search starts here
                 // over current beta (~1 Elo)
                 else if (cutNode)
                     extension = -2;
+
+                if (extension < 0)
+                    SEARCH_STAT(STAT_NEGATIVE_EXT, depth);
             }
 
             // Extension for capturing the previous moved piece (~1 Elo at LTC)
@@ -1503,6 +1629,7 @@ moves_loop:  // When in check, search starts here
 
         // Speculative prefetch as early as possible
         prefetch(tt.first_entry(pos.key_after(move)));
+        Eval::NNUE::prefetch_move(pos, move, networks[numaAccessToken], refreshTable);
 
         // Update the current move (this must be done after singular extension search)
         ss->currentMove = move;
@@ -1514,7 +1641,7 @@ moves_loop:  // When in check, search starts here
 
         // Step 16. Make the move
         thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
-        pos.do_move(move, st, givesCheck);
+        do_move(pos, move, st, givesCheck);
 
         // These reduction adjustments have proven non-linear scaling.
         // They are optimized to time controls of 180 + 1.8 and longer,
@@ -1576,6 +1703,8 @@ moves_loop:  // When in check, search starts here
             Depth d = std::max(
               1, std::min(newDepth - r / 1024, newDepth + !allNode + (PvNode && !bestMove)));
 
+            SEARCH_STAT(STAT_LMR, depth);
+
             value = -search<NonPV>(pos, ss + 1, -(alpha + 1), -alpha, d, true);
 
             // Do a full-depth search when reduced LMR search fails high
@@ -1589,7 +1718,10 @@ moves_loop:  // When in check, search starts here
                 newDepth += doDeeperSearch - doShallowerSearch;
 
                 if (newDepth > d)
+                {
+                    SEARCH_STAT(STAT_LMR_RESEARCH, depth);
                     value = -search<NonPV>(pos, ss + 1, -(alpha + 1), -alpha, newDepth, !cutNode);
+                }
 
                 // Post LMR continuation history updates (~1 Elo)
                 int bonus = (value >= beta) * 2048;
@@ -1624,7 +1756,7 @@ moves_loop:  // When in check, search starts here
         }
 
         // Step 19. Undo move
-        pos.undo_move(move);
+        undo_move(pos, move);
 
         assert(value > -VALUE_INFINITE && value < VALUE_INFINITE);
 
@@ -1632,7 +1764,7 @@ moves_loop:  // When in check, search starts here
         // Finished searching the move. If a stop occurred, the return value of
         // the search cannot be trusted, and we return immediately without updating
         // best move, principal variation nor transposition table.
-        if (threads.stop.load(std::memory_order_relaxed))
+        if (threads.stop.load(std::memory_order_relaxed) || batchStop)
             return VALUE_ZERO;
 
         if (rootNode)
@@ -1737,7 +1869,7 @@ moves_loop:  // When in check, search starts here
     // must be a mate or a stalemate. If we are in a singular extension search then
     // return a fail low score.
 
-    assert(moveCount || !ss->inCheck || excludedMove || !MoveList<LEGAL>(pos).size());
+    assert(moveCount || !ss->inCheck || excludedMove || !count_legal(pos));
 
     // Adjust best value for fail high cases at non-pv nodes
     if (!PvNode && bestValue >= beta && !is_decisive(bestValue) && !is_decisive(beta)
@@ -1860,7 +1992,6 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
 
     Move      pv[MAX_PLY + 1];
     StateInfo st;
-    ASSERT_ALIGNED(&st, Eval::NNUE::CacheLineSize);
 
     Key   posKey;
     Move  move, bestMove;
@@ -1881,6 +2012,8 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
     ss->inCheck        = pos.checkers();
     moveCount          = 0;
 
+    SEARCH_STAT(STAT_QNODE, DEPTH_QS);
+
     // Used to send selDepth info to GUI (selDepth counts from 1, ply from 0)
     if (PvNode && thisThread->selDepth < ss->ply + 1)
         thisThread->selDepth = ss->ply + 1;
@@ -1904,7 +2037,10 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
     if (!PvNode && ttData.depth >= DEPTH_QS
         && is_valid(ttData.value)  // Can happen when !ttHit or when access race in probe()
         && (ttData.bound & (ttData.value >= beta ? BOUND_LOWER : BOUND_UPPER)))
+    {
+        SEARCH_STAT(STAT_QS_TT_CUTOFF, DEPTH_QS);
         return ttData.value;
+    }
 
     // Step 4. Static evaluation of the position
     Value      unadjustedStaticEval = VALUE_NONE;
@@ -1945,6 +2081,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
                 ttWriter.write(posKey, value_to_tt(bestValue, ss->ply), false, BOUND_LOWER,
                                DEPTH_UNSEARCHED, Move::none(), unadjustedStaticEval,
                                tt.generation());
+            SEARCH_STAT(STAT_QS_STAND_PAT, DEPTH_QS);
             return bestValue;
         }
 
@@ -2024,6 +2161,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
 
         // Speculative prefetch as early as possible
         prefetch(tt.first_entry(pos.key_after(move)));
+        Eval::NNUE::prefetch_move(pos, move, networks[numaAccessToken], refreshTable);
 
         // Update the current move
         ss->currentMove = move;
@@ -2035,9 +2173,9 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
 
         // Step 7. Make and search the move
         thisThread->nodes.fetch_add(1, std::memory_order_relaxed);
-        pos.do_move(move, st, givesCheck);
+        do_move(pos, move, st, givesCheck);
         value = -qsearch<nodeType>(pos, ss + 1, -beta, -alpha);
-        pos.undo_move(move);
+        undo_move(pos, move);
 
         assert(value > -VALUE_INFINITE && value < VALUE_INFINITE);
 
@@ -2066,7 +2204,7 @@ Value Search::Worker::qsearch(Position& pos, Stack* ss, Value alpha, Value beta)
     // in check and no legal moves were found, it is checkmate.
     if (ss->inCheck && bestValue == -VALUE_INFINITE)
     {
-        assert(!MoveList<LEGAL>(pos).size());
+        assert(!count_legal(pos));
         return mated_in(ss->ply);  // Plies to mate from the root
     }
 
@@ -2104,10 +2242,34 @@ TimePoint Search::Worker::elapsed() const {
 TimePoint Search::Worker::elapsed_time() const { return main_manager()->tm.elapsed_time(); }
 
 Value Search::Worker::evaluate(const Position& pos) {
-    return Eval::evaluate(networks[numaAccessToken], pos, refreshTable,
+    return Eval::evaluate(networks[numaAccessToken], pos, accumulatorStack, refreshTable,
                           optimism[pos.side_to_move()]);
 }
 
+void Search::Worker::do_move(Position& pos, const Move move, StateInfo& st) {
+    do_move(pos, move, st, pos.gives_check(move));
+}
+
+void Search::Worker::do_move(Position& pos, const Move move, StateInfo& st, const bool givesCheck) {
+    pos.do_move(move, st, givesCheck);
+    accumulatorStack.push(st.dirtyPiece);
+}
+
+void Search::Worker::do_null_move(Position& pos, StateInfo& st) {
+    pos.do_null_move(st, tt);
+    accumulatorStack.push(st.dirtyPiece);
+}
+
+void Search::Worker::undo_move(Position& pos, const Move move) {
+    pos.undo_move(move);
+    accumulatorStack.pop();
+}
+
+void Search::Worker::undo_null_move(Position& pos) {
+    pos.undo_null_move();
+    accumulatorStack.pop();
+}
+
 namespace {
 // Adjusts a mate or TB score from "plies to mate from the root" to
 // "plies to mate from the current position". Standard scores are unchanged.
@@ -2318,11 +2480,12 @@ void SearchManager::check_time(Search::Worker& worker) {
 // Keeps the search based PV for as long as it is verified to maintain the game
 // outcome, truncates afterwards. Finally, extends to mate the PV, providing a
 // possible continuation (but not a proven mating line).
-void syzygy_extend_pv(const OptionsMap&         options,
-                      const Search::LimitsType& limits,
-                      Position&                 pos,
-                      RootMove&                 rootMove,
-                      Value&                    v) {
+void syzygy_extend_pv(const OptionsMap&              options,
+                      const Search::LimitsType&      limits,
+                      Position&                      pos,
+                      RootMove&                      rootMove,
+                      Value&                         v,
+                      const Tablebases::ParallelFor& tbParallel) {
 
     auto t_start      = std::chrono::steady_clock::now();
     int  moveOverhead = int(options["Move Overhead"]);
@@ -2351,7 +2514,8 @@ void syzygy_extend_pv(const OptionsMap&         options,
         for (const auto& m : MoveList<LEGAL>(pos))
             legalMoves.emplace_back(m);
 
-        Tablebases::Config config = Tablebases::rank_root_moves(options, pos, legalMoves);
+        Tablebases::Config config =
+          Tablebases::rank_root_moves(options, pos, legalMoves, false, tbParallel);
         RootMove&          rm     = *std::find(legalMoves.begin(), legalMoves.end(), pvMove);
 
         if (legalMoves[0].tbRank != rm.tbRank)
@@ -2384,7 +2548,7 @@ void syzygy_extend_pv(const OptionsMap&         options,
     // endgames e.g. KRvK.
     while (!pos.is_draw(0))
     {
-        if (time_abort())
+        if (time_abort() || rootMove.pv.full())
             break;
 
         RootMoves legalMoves;
@@ -2411,7 +2575,8 @@ void syzygy_extend_pv(const OptionsMap&         options,
           [](const Search::RootMove& a, const Search::RootMove& b) { return a.tbRank > b.tbRank; });
 
         // The winning side tries to minimize DTZ, the losing side maximizes it
-        Tablebases::Config config = Tablebases::rank_root_moves(options, pos, legalMoves, true);
+        Tablebases::Config config =
+          Tablebases::rank_root_moves(options, pos, legalMoves, true, tbParallel);
 
         // If DTZ is not available we might not find a mate, so we bail out
         if (!config.rootInTB || config.cardinality > 0)
@@ -2439,8 +2604,8 @@ void syzygy_extend_pv(const OptionsMap&         options,
         v = VALUE_DRAW;
 
     // Undo the PV moves
-    for (auto it = rootMove.pv.rbegin(); it != rootMove.pv.rend(); ++it)
-        pos.undo_move(*it);
+    for (int i = int(rootMove.pv.size()) - 1; i >= 0; --i)
+        pos.undo_move(rootMove.pv[i]);
 
     // Inform if we couldn't get a full extension in time
     if (time_abort())
@@ -2449,10 +2614,11 @@ void syzygy_extend_pv(const OptionsMap&         options,
           << sync_endl;
 }
 
-void SearchManager::pv(Search::Worker&           worker,
-                       const ThreadPool&         threads,
-                       const TranspositionTable& tt,
-                       Depth                     depth) {
+void SearchManager::pv(Search::Worker&                worker,
+                       const ThreadPool&              threads,
+                       const TranspositionTable&      tt,
+                       Depth                          depth,
+                       const Tablebases::ParallelFor& tbParallel) {
 
     const auto nodes     = threads.nodes_searched();
     auto&      rootMoves = worker.rootMoves;
@@ -2482,15 +2648,18 @@ void SearchManager::pv(Search::Worker&           worker,
         // Potentially correct and extend the PV, and in exceptional cases v
         if (is_decisive(v) && std::abs(v) < VALUE_MATE_IN_MAX_PLY
             && ((!rootMoves[i].scoreLowerbound && !rootMoves[i].scoreUpperbound) || isExact))
-            syzygy_extend_pv(worker.options, worker.limits, pos, rootMoves[i], v);
+            syzygy_extend_pv(worker.options, worker.limits, pos, rootMoves[i], v, tbParallel);
 
-        std::string pv;
+        pvString.clear();
         for (Move m : rootMoves[i].pv)
-            pv += UCIEngine::move(m, pos.is_chess960()) + " ";
+        {
+            pvString += UCIEngine::move(m, pos.is_chess960());
+            pvString += ' ';
+        }
 
         // Remove last whitespace
-        if (!pv.empty())
-            pv.pop_back();
+        if (!pvString.empty())
+            pvString.pop_back();
 
         auto wdl   = worker.options["UCI_ShowWDL"] ? UCIEngine::wdl(v, pos) : "";
         auto bound = rootMoves[i].scoreLowerbound
@@ -2513,7 +2682,7 @@ void SearchManager::pv(Search::Worker&           worker,
         info.nodes     = nodes;
         info.nps       = nodes * 1000 / time;
         info.tbHits    = tbHits;
-        info.pv        = pv;
+        info.pv        = pvString;
         info.hashfull  = tt.hashfull();
 
         updates.onUpdateFull(info);
@@ -2527,7 +2696,6 @@ void SearchManager::pv(Search::Worker&           worker,
 bool RootMove::extract_ponder_from_tt(const TranspositionTable& tt, Position& pos) {
 
     StateInfo st;
-    ASSERT_ALIGNED(&st, Eval::NNUE::CacheLineSize);
 
     assert(pv.size() == 1);
     if (pv[0] == Move::none())
@@ -22,6 +22,7 @@
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <cassert>
 #include <cstddef>
 #include <cstdint>
@@ -38,6 +39,7 @@
 #include "numa.h"
 #include "position.h"
 #include "score.h"
+#include "searchstats.h"
 #include "syzygy/tbprobe.h"
 #include "timeman.h"
 #include "evaluate.h"
@@ -93,13 +95,17 @@ struct Stack {
 };
 
 
+// A principal variation stored inline, so that RootMoves can be copied and
+// sorted without touching the heap. A PV built by search() holds at most
+// MAX_PLY moves below the root move.
+using PVLine = ValueList<Move, MAX_PLY + 1>;
+
 // RootMove struct is used for moves at the root of the tree. For each root move
 // we store a score and a PV (really a refutation in the case of moves which
 // fail low). Score is normally set at -VALUE_INFINITE for all non-pv moves.
 struct RootMove {
 
-    explicit RootMove(Move m) :
-        pv(1, m) {}
+    explicit RootMove(Move m) { pv.push_back(m); }
     bool extract_ponder_from_tt(const TranspositionTable& tt, Position& pos);
     bool operator==(const Move& m) const { return pv[0] == m; }
     // Sort in descending order
@@ -118,7 +124,7 @@ struct RootMove {
     int               selDepth         = 0;
     int               tbRank           = 0;
     Value             tbScore          = 0;
-    std::vector<Move> pv;
+    PVLine            pv;
 };
 
 using RootMoves = std::vector<RootMove>;
@@ -200,6 +206,15 @@ struct InfoIteration {
     size_t           currmovenumber;
 };
 
+struct InfoBatch: InfoShort {
+    size_t           index;
+    size_t           nodes;
+    std::string_view bestmove;
+    std::string_view pv;
+};
+
+using UpdateBatch = std::function<void(const InfoBatch&)>;
+
 // Skill structure is used to implement strength limit. If we have a UCI_Elo,
 // we convert it to an appropriate skill level, anchored to the Stash engine.
 // This method is based on a fit of the Elo results for games played between
@@ -250,10 +265,11 @@ class SearchManager: public ISearchManager {
 
     void check_time(Search::Worker& worker) override;
 
-    void pv(Search::Worker&           worker,
-            const ThreadPool&         threads,
-            const TranspositionTable& tt,
-            Depth                     depth);
+    void pv(Search::Worker&                worker,
+            const ThreadPool&              threads,
+            const TranspositionTable&      tt,
+            Depth                          depth,
+            const Tablebases::ParallelFor& tbParallel = {});
 
     Judas::TimeManagement tm;
     double                    originalTimeAdjust;
@@ -269,6 +285,10 @@ class SearchManager: public ISearchManager {
     size_t id;
 
     const UpdateContext& updates;
+
+   private:
+    // Reused between calls to pv() to avoid building a new string per line
+    std::string pvString;
 };
 
 class NullSearchManager: public ISearchManager {
@@ -292,6 +312,10 @@ class Worker {
     // It searches from the root position and outputs the "bestmove".
     void start_searching();
 
+    // Searches 'fen' on this thread alone, as one job of a batch analysis.
+    // Depth and node limits are applied per worker, the TT stays shared.
+    void batch_search(size_t index, const std::string& fen, const LimitsType&, const UpdateBatch&);
+
     bool is_mainthread() const { return threadIdx == 0; }
 
     void ensure_network_replicated();
@@ -334,11 +358,26 @@ class Worker {
 
     Value evaluate(const Position&);
 
+    // Make and unmake moves on the search path, keeping the accumulator
+    // stack in step with the position.
+    void do_move(Position& pos, const Move move, StateInfo& st);
+    void do_move(Position& pos, const Move move, StateInfo& st, const bool givesCheck);
+    void do_null_move(Position& pos, StateInfo& st);
+    void undo_move(Position& pos, const Move move);
+    void undo_null_move(Position& pos);
+
     LimitsType limits;
 
     size_t                pvIdx, pvLast;
     std::atomic<uint64_t> nodes, tbHits, bestMoveChanges;
     int                   selDepth, nmpMinPly;
+    bool                  batchSearch = false, batchStop = false;
+
+    // Helpers only, from the release by the main thread to the search start
+    std::chrono::steady_clock::duration wakeupLatency{};
+
+    // Only updated when compiled with SEARCH_STATS
+    SearchStats stats;
 
     Value optimism[COLOR_NB];
 
@@ -366,8 +405,11 @@ class Worker {
     const LazyNumaReplicated<Eval::NNUE::Networks>& networks;
 
     // Used by NNUE
+    Eval::NNUE::AccumulatorStack  accumulatorStack;
     Eval::NNUE::AccumulatorCaches refreshTable;
 
+    Tablebases::WDLCache tbCache;
+
     friend class Judas::ThreadPool;
     friend class SearchManager;
 };
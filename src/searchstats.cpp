@@ -0,0 +1,86 @@
+/*
+  JudaS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  JudaS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  JudaS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "searchstats.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace Judas::Search {
+
+namespace {
+
+constexpr const char* StepNames[STAT_STEP_NB] = {
+  "nodes",           "tt cutoff",       "learning cutoff", "tb probe",        "tb cutoff",
+  "razoring",        "futility",        "null move",       "iir",             "probcut",
+  "small probcut",   "move count",      "capt futility",   "capt see",        "history prune",
+  "parent futility", "quiet see",       "singular ext",    "multi-cut",       "negative ext",
+  "lmr",             "lmr re-search",   "qs nodes",        "qs tt cutoff",    "qs stand pat"};
+
+constexpr const char* BucketNames[STAT_DEPTH_BUCKET_NB] = {"d<=0", "d1-2",  "d3-4",
+                                                           "d5-7", "d8-11", "d12+"};
+
+}  // namespace
+
+// Formats the counters as a table, one line per step and one column per depth
+// bucket, followed by the total and its share of all the nodes searched.
+std::string to_string(const SearchStats& stats) {
+    std::stringstream ss;
+
+    const uint64_t allNodes = [&] {
+        uint64_t n = 0;
+        for (int b = 0; b < STAT_DEPTH_BUCKET_NB; ++b)
+            n += stats.counts[STAT_NODE][b] + stats.counts[STAT_QNODE][b];
+        return std::max(n, uint64_t(1));
+    }();
+
+    ss << std::left << std::setw(16) << "step" << std::right;
+    for (const char* name : BucketNames)
+        ss << std::setw(12) << name;
+    ss << std::setw(14) << "total" << std::setw(9) << "% nodes" << "\n";
+
+    for (int s = 0; s < STAT_STEP_NB; ++s)
+    {
+        uint64_t total = 0;
+
+        ss << std::left << std::setw(16) << StepNames[s] << std::right;
+        for (int b = 0; b < STAT_DEPTH_BUCKET_NB; ++b)
+        {
+            ss << std::setw(12) << stats.counts[s][b];
+            total += stats.counts[s][b];
+        }
+
+        ss << std::setw(14) << total << std::setw(9) << std::fixed << std::setprecision(2)
+           << 100.0 * total / allNodes << "\n";
+    }
+
+    uint64_t tbProbes = 0;
+    for (int b = 0; b < STAT_DEPTH_BUCKET_NB; ++b)
+        tbProbes += stats.counts[STAT_TB_PROBE][b];
+
+    ss << "\ntablebase hits " << stats.tbHits << " of " << tbProbes << " probes (" << std::fixed
+       << std::setprecision(2) << 100.0 * stats.tbHits / std::max(tbProbes, uint64_t(1))
+       << "%), cache hits " << stats.tbCacheHits << " of " << stats.tbCacheProbes << " ("
+       << 100.0 * stats.tbCacheHits / std::max(stats.tbCacheProbes, uint64_t(1)) << "%)\n";
+
+    return ss.str();
+}
+
+}  // namespace Judas::Search
@@ -0,0 +1,106 @@
+/*
+  JudaS, a UCI chess playing engine derived from Stockfish
+  Copyright (C) 2004-2025 The Stockfish developers (see AUTHORS file)
+
+  JudaS is free software: you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation, either version 3 of the License, or
+  (at your option) any later version.
+
+  JudaS is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#ifndef SEARCHSTATS_H_INCLUDED
+#define SEARCHSTATS_H_INCLUDED
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "types.h"
+
+namespace Judas::Search {
+
+// Search steps and events that can be counted per thread. Counting is only
+// compiled in with SEARCH_STATS (make searchstats=yes), see SEARCH_STAT below.
+enum StatStep : int {
+    STAT_NODE,
+    STAT_TT_CUTOFF,
+    STAT_LEARNING_CUTOFF,
+    STAT_TB_PROBE,
+    STAT_TB_CUTOFF,
+    STAT_RAZORING,
+    STAT_FUTILITY,
+    STAT_NULL_MOVE,
+    STAT_IIR,
+    STAT_PROBCUT,
+    STAT_SMALL_PROBCUT,
+    STAT_MOVE_COUNT_PRUNING,
+    STAT_CAPTURE_FUTILITY,
+    STAT_CAPTURE_SEE,
+    STAT_HISTORY_PRUNING,
+    STAT_PARENT_FUTILITY,
+    STAT_QUIET_SEE,
+    STAT_SINGULAR_EXT,
+    STAT_MULTI_CUT,
+    STAT_NEGATIVE_EXT,
+    STAT_LMR,
+    STAT_LMR_RESEARCH,
+    STAT_QNODE,
+    STAT_QS_TT_CUTOFF,
+    STAT_QS_STAND_PAT,
+    STAT_STEP_NB
+};
+
+constexpr int STAT_DEPTH_BUCKET_NB = 6;
+
+// Per thread counters, indexed by step and depth bucket. Each thread only
+// writes its own instance, they are summed up when the search is idle.
+struct SearchStats {
+
+    static constexpr int depth_bucket(Depth d) {
+        return d <= 0 ? 0 : d <= 2 ? 1 : d <= 4 ? 2 : d <= 7 ? 3 : d <= 11 ? 4 : 5;
+    }
+
+    void hit(StatStep step, Depth d) { ++counts[step][depth_bucket(d)]; }
+
+    void clear() {
+        for (auto& row : counts)
+            row.fill(0);
+        tbHits = tbCacheProbes = tbCacheHits = 0;
+    }
+
+    SearchStats& operator+=(const SearchStats& other) {
+        for (int s = 0; s < STAT_STEP_NB; ++s)
+            for (int b = 0; b < STAT_DEPTH_BUCKET_NB; ++b)
+                counts[s][b] += other.counts[s][b];
+        tbHits += other.tbHits;
+        tbCacheProbes += other.tbCacheProbes;
+        tbCacheHits += other.tbCacheHits;
+        return *this;
+    }
+
+    std::array<std::array<uint64_t, STAT_DEPTH_BUCKET_NB>, STAT_STEP_NB> counts{};
+
+    // Copied from the thread's tbHits and Tablebases::WDLCache
+    uint64_t tbHits = 0, tbCacheProbes = 0, tbCacheHits = 0;
+};
+
+std::string to_string(const SearchStats& stats);
+
+}  // namespace Judas::Search
+
+#ifdef SEARCH_STATS
+    #define SEARCH_STAT(step, depth) stats.hit(Search::step, depth)
+#else
+    #define SEARCH_STAT(step, depth) ((void) 0)
+#endif
+
+#endif  // #ifndef SEARCHSTATS_H_INCLUDED
@@ -26,12 +26,14 @@
 #include <cstring>
 #include <deque>
 #include <fstream>
+#include <functional>
 #include <initializer_list>
 #include <iostream>
 #include <mutex>
 #include <sstream>
 #include <string_view>
 #include <sys/stat.h>
+#include <thread>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -201,6 +203,12 @@ class TBFile: public std::ifstream {
     // C:\tb\wdl345;C:\tb\wdl6;D:\tb\dtz345;D:\tb\dtz6
     static std::string Paths;
 
+    // How the kernel is advised to page in the mapped files
+    static MapAdvice Advice;
+
+    // Total size of the files mapped since the last init
+    static std::atomic<uint64_t> MappedBytes;
+
     TBFile(const std::string& f) {
 
 #ifndef _WIN32
@@ -243,7 +251,12 @@ class TBFile: public std::ifstream {
         *mapping     = statbuf.st_size;
         *baseAddress = mmap(nullptr, statbuf.st_size, PROT_READ, MAP_SHARED, fd, 0);
     #if defined(MADV_RANDOM)
-        madvise(*baseAddress, statbuf.st_size, MADV_RANDOM);
+        int advice = MADV_RANDOM;
+        #if defined(MADV_WILLNEED)
+        if (Advice == MapAdvice::WillNeed)
+            advice = MADV_WILLNEED;
+        #endif
+        madvise(*baseAddress, statbuf.st_size, advice);
     #endif
         ::close(fd);
 
@@ -252,6 +265,8 @@ class TBFile: public std::ifstream {
             std::cerr << "Could not mmap() " << fname << std::endl;
             exit(EXIT_FAILURE);
         }
+
+        MappedBytes += statbuf.st_size;
 #else
         // Note FILE_FLAG_RANDOM_ACCESS is only a hint to Windows and as such may get ignored.
         HANDLE fd = CreateFileA(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
@@ -287,6 +302,8 @@ class TBFile: public std::ifstream {
                       << ", error = " << GetLastError() << std::endl;
             exit(EXIT_FAILURE);
         }
+
+        MappedBytes += (uint64_t(size_high) << 32) | size_low;
 #endif
         uint8_t* data = (uint8_t*) *baseAddress;
 
@@ -313,7 +330,9 @@ class TBFile: public std::ifstream {
     }
 };
 
-std::string TBFile::Paths;
+std::string           TBFile::Paths;
+MapAdvice             TBFile::Advice = MapAdvice::Random;
+std::atomic<uint64_t> TBFile::MappedBytes;
 
 // struct PairsData contains low-level indexing information to access TB data.
 // There are 8, 4, or 2 PairsData records for each TBTable, according to the type
@@ -353,11 +372,13 @@ struct TBTable {
     static constexpr int Sides = Type == WDL ? 2 : 1;
 
     std::atomic_bool ready;
+    std::once_flag   mapOnce;
     void*            baseAddress;
     uint8_t*         map;
     uint64_t         mapping;
     Key              key;
     Key              key2;
+    std::string      name;  // Like "KRvK", the file name without extension
     int              pieceCount;
     bool             hasPawns;
     bool             hasUniquePieces;
@@ -385,6 +406,7 @@ TBTable<WDL>::TBTable(const std::string& code) :
     StateInfo st;
     Position  pos;
 
+    name       = code;
     key        = pos.set(code, WHITE, &st).material_key();
     pieceCount = pos.count<ALL_PIECES>();
     hasPawns   = pos.pieces(PAWN);
@@ -413,6 +435,7 @@ TBTable<DTZ>::TBTable(const TBTable<WDL>& wdl) :
     // Use the corresponding WDL table to avoid recalculating all from scratch
     key             = wdl.key;
     key2            = wdl.key2;
+    name            = wdl.name;
     pieceCount      = wdl.pieceCount;
     hasPawns        = wdl.hasPawns;
     hasUniquePieces = wdl.hasUniquePieces;
@@ -446,6 +469,9 @@ class TBTables {
     size_t                   foundDTZFiles = 0;
     size_t                   foundWDLFiles = 0;
 
+    std::thread      warmUpThread;
+    std::atomic_bool stopWarmUp{false};
+
     void insert(Key key, TBTable<WDL>* wdl, TBTable<DTZ>* dtz) {
         uint32_t homeBucket = uint32_t(key) & (Size - 1);
         Entry    entry{key, wdl, dtz};
@@ -475,6 +501,8 @@ class TBTables {
     }
 
    public:
+    ~TBTables() { stop_warm_up(); }
+
     template<TBType Type>
     TBTable<Type>* get(Key key) {
         for (const Entry* entry = &hashTable[uint32_t(key) & (Size - 1)];; ++entry)
@@ -485,6 +513,7 @@ class TBTables {
     }
 
     void clear() {
+        stop_warm_up();
         memset(hashTable, 0, sizeof(hashTable));
         wdlTable.clear();
         dtzTable.clear();
@@ -498,6 +527,13 @@ class TBTables {
     }
 
     void add(const std::vector<PieceType>& pieces);
+    void warm_up(int maxPieces);
+
+    void stop_warm_up() {
+        stopWarmUp = true;
+        if (warmUpThread.joinable())
+            warmUpThread.join();
+    }
 };
 
 TBTables TBTables;
@@ -1206,45 +1242,63 @@ void set(T& e, uint8_t* data) {
         }
 }
 
-// If the TB file corresponding to the given position is already memory-mapped
-// then return its base address, otherwise, try to memory map and init it. Called
-// at every probe, memory map, and init only at first access. Function is thread
-// safe and can be called concurrently.
+// If the TB file of the given table is already memory-mapped then return its
+// base address, otherwise, try to memory map and init it. Called at every probe,
+// memory map, and init only at first access or by the warm-up. Function is
+// thread safe and can be called concurrently. Each table has its own guard, so
+// threads touching different tables for the first time do not wait for each other.
 template<TBType Type>
-void* mapped(TBTable<Type>& e, const Position& pos) {
-
-    static std::mutex mutex;
+void* mapped(TBTable<Type>& e) {
 
     // Use 'acquire' to avoid a thread reading 'ready' == true while
     // another is still working. (compiler reordering may cause this).
     if (e.ready.load(std::memory_order_acquire))
         return e.baseAddress;  // Could be nullptr if file does not exist
 
-    std::scoped_lock<std::mutex> lk(mutex);
-
-    if (e.ready.load(std::memory_order_relaxed))  // Recheck under lock
-        return e.baseAddress;
+    std::call_once(e.mapOnce, [&] {
+        const std::string fname = e.name + (Type == WDL ? ".rtbw" : ".rtbz");
 
-    // Pieces strings in decreasing order for each color, like ("KPP","KR")
-    std::string fname, w, b;
-    for (PieceType pt = KING; pt >= PAWN; --pt)
-    {
-        w += std::string(popcount(pos.pieces(WHITE, pt)), PieceToChar[pt]);
-        b += std::string(popcount(pos.pieces(BLACK, pt)), PieceToChar[pt]);
-    }
-
-    fname =
-      (e.key == pos.material_key() ? w + 'v' + b : b + 'v' + w) + (Type == WDL ? ".rtbw" : ".rtbz");
+        uint8_t* data = TBFile(fname).map(&e.baseAddress, &e.mapping, Type);
 
-    uint8_t* data = TBFile(fname).map(&e.baseAddress, &e.mapping, Type);
+        if (data)
+            set(e, data);
 
-    if (data)
-        set(e, data);
+        e.ready.store(true, std::memory_order_release);
+    });
 
-    e.ready.store(true, std::memory_order_release);
     return e.baseAddress;
 }
 
+// Maps and parses the tables of up to maxPieces pieces on background threads,
+// so that the first probes of the search find them ready. Reports the mapped
+// files, their size and the time taken when done.
+void TBTables::warm_up(int maxPieces) {
+
+    stopWarmUp   = false;
+    warmUpThread = std::thread([this, maxPieces] {
+        const TimePoint start   = now();
+        const unsigned  workers = std::clamp(std::thread::hardware_concurrency(), 1U, 4U);
+
+        std::atomic<size_t>      next(0), files(0);
+        std::vector<std::thread> threads;
+
+        for (unsigned i = 0; i < workers; ++i)
+            threads.emplace_back([&] {
+                for (size_t idx; !stopWarmUp && (idx = next++) < wdlTable.size();)
+                    if (wdlTable[idx].pieceCount <= maxPieces)
+                        files += bool(mapped(wdlTable[idx])) + bool(mapped(dtzTable[idx]));
+            });
+
+        for (auto& th : threads)
+            th.join();
+
+        if (!stopWarmUp)
+            sync_cout << "info string Syzygy prefetch mapped " << files << " files of up to "
+                      << maxPieces << " pieces, " << (TBFile::MappedBytes >> 20) << " MiB in "
+                      << now() - start << " ms" << sync_endl;
+    });
+}
+
 template<TBType Type, typename Ret = typename TBTable<Type>::Ret>
 Ret probe_table(const Position& pos, ProbeState* result, WDLScore wdl = WDLDraw) {
 
@@ -1253,7 +1307,7 @@ Ret probe_table(const Position& pos, ProbeState* result, WDLScore wdl = WDLDraw)
 
     TBTable<Type>* entry = TBTables.get<Type>(pos.material_key());
 
-    if (!entry || !mapped(*entry, pos))
+    if (!entry || !mapped(*entry))
         return *result = FAIL, Ret();
 
     return do_probe_table(pos, entry, wdl, result);
@@ -1337,12 +1391,15 @@ WDLScore search(Position& pos, ProbeState* result) {
 
 // Called at startup and after every change to
 // "SyzygyPath" UCI option to (re)create the various tables. It is not thread
-// safe, nor it needs to be.
-void Tablebases::init(const std::string& paths) {
+// safe, nor it needs to be. With warmUpPieces the tables of up to that many
+// pieces are mapped in the background right away.
+void Tablebases::init(const std::string& paths, int warmUpPieces, MapAdvice advice) {
 
     TBTables.clear();
-    MaxCardinality = 0;
-    TBFile::Paths  = paths;
+    MaxCardinality      = 0;
+    TBFile::Paths       = paths;
+    TBFile::Advice      = advice;
+    TBFile::MappedBytes = 0;
 
     if (paths.empty())
         return;
@@ -1485,6 +1542,9 @@ void Tablebases::init(const std::string& paths) {
     }
 
     TBTables.info();
+
+    if (warmUpPieces)
+        TBTables.warm_up(warmUpPieces);
 }
 
 // Probe the WDL table for a particular position.
@@ -1566,7 +1626,7 @@ int Tablebases::probe_dtz(Position& pos, ProbeState* result) {
         dtz = zeroing ? -dtz_before_zeroing(search<false>(pos, result)) : -probe_dtz(pos, result);
 
         // If the move mates, force minDTZ to 1
-        if (dtz == 1 && pos.checkers() && MoveList<LEGAL>(pos).size() == 0)
+        if (dtz == 1 && pos.checkers() && !count_legal(pos))
             minDTZ = 1;
 
         // Convert result from 1-ply search. Zeroing moves are already accounted
@@ -1588,6 +1648,44 @@ int Tablebases::probe_dtz(Position& pos, ProbeState* result) {
     return minDTZ == 0xFFFF ? -1 : minDTZ;
 }
 
+namespace {
+
+// Runs probe() for every root move. Without a ParallelFor the moves are probed
+// one after the other on pos, stopping at the first failure. Otherwise they are
+// probed in parallel, each on its own copy of the root position with the game
+// history attached. Returns false if any of the probes failed.
+bool probe_root_moves(Position&                                                pos,
+                      Search::RootMoves&                                       rootMoves,
+                      const ParallelFor&                                       parallel,
+                      const std::function<bool(Position&, Search::RootMove&)>& probe) {
+
+    if (!parallel)
+    {
+        for (auto& m : rootMoves)
+            if (!probe(pos, m))
+                return false;
+
+        return true;
+    }
+
+    const std::string fen = pos.fen();
+    std::atomic_bool  ok(true);
+
+    parallel(rootMoves.size(), [&](size_t i) {
+        StateInfo rootState;
+        Position  rootPos;
+
+        rootPos.set(fen, pos.is_chess960(), &rootState);
+        rootState = *pos.state();
+
+        if (!probe(rootPos, rootMoves[i]))
+            ok = false;
+    });
+
+    return ok;
+}
+
+}  // namespace
 
 // Use the DTZ tables to rank root moves.
 //
@@ -1595,10 +1693,8 @@ int Tablebases::probe_dtz(Position& pos, ProbeState* result) {
 bool Tablebases::root_probe(Position&          pos,
                             Search::RootMoves& rootMoves,
                             bool               rule50,
-                            bool               rankDTZ) {
-
-    ProbeState result = OK;
-    StateInfo  st;
+                            bool               rankDTZ,
+                            const ParallelFor& parallel) {
 
     // Obtain 50-move counter for the root position
     int cnt50 = pos.rule50_count();
@@ -1606,21 +1702,24 @@ bool Tablebases::root_probe(Position&          pos,
     // Check whether a position was repeated since the last zeroing move.
     bool rep = pos.has_repeated();
 
-    int dtz, bound = rule50 ? (MAX_DTZ / 2 - 100) : 1;
+    int bound = rule50 ? (MAX_DTZ / 2 - 100) : 1;
 
     // Probe and rank each move
-    for (auto& m : rootMoves)
-    {
-        pos.do_move(m.pv[0], st);
+    return probe_root_moves(pos, rootMoves, parallel, [&](Position& p, Search::RootMove& m) {
+        ProbeState result = OK;
+        StateInfo  st;
+        int        dtz;
+
+        p.do_move(m.pv[0], st);
 
         // Calculate dtz for the current move counting from the root position
-        if (pos.rule50_count() == 0)
+        if (p.rule50_count() == 0)
         {
             // In case of a zeroing move, dtz is one of -101/-1/0/1/101
-            WDLScore wdl = -probe_wdl(pos, &result);
+            WDLScore wdl = -probe_wdl(p, &result);
             dtz          = dtz_before_zeroing(wdl);
         }
-        else if (pos.is_draw(1))
+        else if (p.is_draw(1))
         {
             // In case a root move leads to a draw by repetition or 50-move rule,
             // we set dtz to zero. Note: since we are only 1 ply from the root,
@@ -1630,15 +1729,15 @@ bool Tablebases::root_probe(Position&          pos,
         else
         {
             // Otherwise, take dtz for the new position and correct by 1 ply
-            dtz = -probe_dtz(pos, &result);
+            dtz = -probe_dtz(p, &result);
             dtz = dtz > 0 ? dtz + 1 : dtz < 0 ? dtz - 1 : dtz;
         }
 
         // Make sure that a mating move is assigned a dtz value of 1
-        if (pos.checkers() && dtz == 2 && MoveList<LEGAL>(pos).size() == 0)
+        if (p.checkers() && dtz == 2 && !count_legal(p))
             dtz = 1;
 
-        pos.undo_move(m.pv[0]);
+        p.undo_move(m.pv[0]);
 
         if (result == FAIL)
             return false;
@@ -1661,9 +1760,9 @@ bool Tablebases::root_probe(Position&          pos,
                   : r > -bound
                     ? Value((std::min(-3, r + (MAX_DTZ / 2 - 200)) * int(PawnValue)) / 200)
                     : -VALUE_MATE + MAX_PLY + 1;
-    }
 
-    return true;
+        return true;
+    });
 }
 
 
@@ -1671,26 +1770,27 @@ bool Tablebases::root_probe(Position&          pos,
 // This is a fallback for the case that some or all DTZ tables are missing.
 //
 // A return value false indicates that not all probes were successful.
-bool Tablebases::root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, bool rule50) {
+bool Tablebases::root_probe_wdl(Position&          pos,
+                                Search::RootMoves& rootMoves,
+                                bool               rule50,
+                                const ParallelFor& parallel) {
 
     static const int WDL_to_rank[] = {-MAX_DTZ, -MAX_DTZ + 101, 0, MAX_DTZ - 101, MAX_DTZ};
 
-    ProbeState result = OK;
-    StateInfo  st;
-    WDLScore   wdl;
-
-
     // Probe and rank each move
-    for (auto& m : rootMoves)
-    {
-        pos.do_move(m.pv[0], st);
+    return probe_root_moves(pos, rootMoves, parallel, [&](Position& p, Search::RootMove& m) {
+        ProbeState result = OK;
+        StateInfo  st;
+        WDLScore   wdl;
 
-        if (pos.is_draw(1))
+        p.do_move(m.pv[0], st);
+
+        if (p.is_draw(1))
             wdl = WDLDraw;
         else
-            wdl = -probe_wdl(pos, &result);
+            wdl = -probe_wdl(p, &result);
 
-        pos.undo_move(m.pv[0]);
+        p.undo_move(m.pv[0]);
 
         if (result == FAIL)
             return false;
@@ -1700,15 +1800,16 @@ bool Tablebases::root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, boo
         if (!rule50)
             wdl = wdl > WDLDraw ? WDLWin : wdl < WDLDraw ? WDLLoss : WDLDraw;
         m.tbScore = WDL_to_value[wdl + 2];
-    }
 
-    return true;
+        return true;
+    });
 }
 
 Config Tablebases::rank_root_moves(const OptionsMap&  options,
                                    Position&          pos,
                                    Search::RootMoves& rootMoves,
-                                   bool               rankDTZ) {
+                                   bool               rankDTZ,
+                                   const ParallelFor& parallel) {
     Config config;
 
     if (rootMoves.empty())
@@ -1732,13 +1833,15 @@ Config Tablebases::rank_root_moves(const OptionsMap&  options,
     if (config.cardinality >= popcount(pos.pieces()) && !pos.can_castle(ANY_CASTLING))
     {
         // Rank moves using DTZ tables
-        config.rootInTB = root_probe(pos, rootMoves, options["Syzygy50MoveRule"], rankDTZ);
+        config.rootInTB =
+          root_probe(pos, rootMoves, options["Syzygy50MoveRule"], rankDTZ, parallel);
 
         if (!config.rootInTB)
         {
             // DTZ tables are missing; try to rank moves using WDL tables
             dtz_available   = false;
-            config.rootInTB = root_probe_wdl(pos, rootMoves, options["Syzygy50MoveRule"]);
+            config.rootInTB =
+              root_probe_wdl(pos, rootMoves, options["Syzygy50MoveRule"], parallel);
         }
     }
 
@@ -19,6 +19,9 @@
 #ifndef TBPROBE_H
 #define TBPROBE_H
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
 #include <string>
 #include <vector>
 
@@ -62,16 +65,101 @@ enum ProbeState {
 
 extern int MaxCardinality;
 
+// WDLCache keeps the results of successful WDL probes per position key, so
+// that positions reached again skip the table decompression. Each thread owns
+// one. A bucket fills a cache line and holds the most recently stored entries
+// first.
+class WDLCache {
+
+    struct Entry {
+        uint32_t key32;
+        int32_t  wdl;
+    };
+
+    static constexpr int     EntriesPerBucket = 8;
+    static constexpr size_t  BucketCount      = 1 << 13;
+    static constexpr int32_t Empty            = WDLWin + 1;
+
+    struct alignas(64) Bucket {
+        Entry entry[EntriesPerBucket];
+    };
+
+    static_assert(sizeof(Bucket) == 64, "Unexpected Bucket size");
+
+   public:
+    bool probe(uint64_t key, WDLScore& wdl) {
+        const Bucket& b   = buckets[key & (BucketCount - 1)];
+        const auto    k32 = uint32_t(key >> 32);
+
+#ifdef SEARCH_STATS
+        ++probes;
+#endif
+        for (const Entry& e : b.entry)
+            if (e.key32 == k32 && e.wdl != Empty)
+            {
+                wdl = WDLScore(e.wdl);
+#ifdef SEARCH_STATS
+                ++hits;
+#endif
+                return true;
+            }
+
+        return false;
+    }
+
+    void save(uint64_t key, WDLScore wdl) {
+        Bucket& b = buckets[key & (BucketCount - 1)];
+
+        for (int i = EntriesPerBucket - 1; i > 0; --i)
+            b.entry[i] = b.entry[i - 1];
+
+        b.entry[0] = {uint32_t(key >> 32), int32_t(wdl)};
+    }
+
+    void clear() {
+        for (Bucket& b : buckets)
+            for (Entry& e : b.entry)
+                e = {0, Empty};
+
+        probes = hits = 0;
+    }
+
+    // Only updated when compiled with SEARCH_STATS
+    uint64_t probes = 0, hits = 0;
+
+   private:
+    Bucket buckets[BucketCount];
+};
+
+
+// How the kernel is advised to page in the mapped table files
+enum class MapAdvice {
+    Random,
+    WillNeed
+};
+
+void init(const std::string& paths, int warmUpPieces = 0, MapAdvice advice = MapAdvice::Random);
+
+// Runs job(0) .. job(count - 1), possibly in parallel, returning when all are
+// done. Given to the root ranking to probe the root moves concurrently.
+using ParallelFor = std::function<void(size_t count, const std::function<void(size_t)>& job)>;
 
-void     init(const std::string& paths);
 WDLScore probe_wdl(Position& pos, ProbeState* result);
 int      probe_dtz(Position& pos, ProbeState* result);
-bool     root_probe(Position& pos, Search::RootMoves& rootMoves, bool rule50, bool rankDTZ);
-bool     root_probe_wdl(Position& pos, Search::RootMoves& rootMoves, bool rule50);
+bool     root_probe(Position&          pos,
+                    Search::RootMoves& rootMoves,
+                    bool               rule50,
+                    bool               rankDTZ,
+                    const ParallelFor& parallel = {});
+bool     root_probe_wdl(Position&          pos,
+                        Search::RootMoves& rootMoves,
+                        bool               rule50,
+                        const ParallelFor& parallel = {});
 Config   rank_root_moves(const OptionsMap&  options,
                          Position&          pos,
                          Search::RootMoves& rootMoves,
-                         bool               rankDTZ = false);
+                         bool               rankDTZ  = false,
+                         const ParallelFor& parallel = {});
 
 }  // namespace Judas::Tablebases
 
@@ -20,6 +20,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
 #include <deque>
 #include <memory>
 #include <string>
@@ -34,8 +35,27 @@
 #include "uci.h"
 #include "ucioption.h"
 
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <immintrin.h>
+#endif
+
 namespace Judas {
 
+namespace {
+
+// Hints the CPU that we are in a spin-wait loop
+inline void cpu_relax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+}  // namespace
+
 // Constructor launches the thread and waits until it goes to sleep
 // in idle_loop(). Note that 'searching' and 'exit' should be already set.
 Thread::Thread(Search::SharedState&                    sharedState,
@@ -44,17 +64,21 @@ Thread::Thread(Search::SharedState&                    sharedState,
                OptionalThreadToNumaNodeBinder          binder) :
     idx(n),
     nthreads(sharedState.options["Threads"]),
+    ackEpoch(sharedState.threads.wakeup.epoch.load()),
+    wakeup(sharedState.threads.wakeup),
     stdThread(&Thread::idle_loop, this) {
 
     wait_for_search_finished();
 
     run_custom_job([this, &binder, &sharedState, &sm, n]() {
         // Use the binder to [maybe] bind the threads to a NUMA node before doing
-        // the Worker allocation. Ideally we would also allocate the SearchManager
-        // here, but that's minor.
+        // the Worker allocation. The Worker holds the history tables, so it is
+        // placed in large pages and first touched (cleared) by its own thread,
+        // which keeps it on the thread's NUMA node. Ideally we would also
+        // allocate the SearchManager here, but that's minor.
         this->numaAccessToken = binder();
-        this->worker =
-          std::make_unique<Search::Worker>(sharedState, std::move(sm), n, this->numaAccessToken);
+        this->worker          = make_unique_large_page<Search::Worker>(
+          sharedState, std::move(sm), n, this->numaAccessToken);
     });
 
     wait_for_search_finished();
@@ -84,24 +108,67 @@ void Thread::clear_worker() {
     run_custom_job([this]() { worker->clear(); });
 }
 
+// True if the pool has started a search that this helper has not picked up yet.
+// The main thread is always started explicitly and never follows the epoch.
+bool Thread::has_pending_epoch() const {
+    return idx != 0 && ackEpoch.load(std::memory_order_relaxed) != wakeup.epoch.load();
+}
+
 // Blocks on the condition variable until the thread has finished searching
 void Thread::wait_for_search_finished() {
 
     std::unique_lock<std::mutex> lk(mutex);
-    cv.wait(lk, [&] { return !searching; });
+    cv.wait(lk, [&] { return !searching && !has_pending_epoch(); });
 }
 
 // Launching a function in the thread
 void Thread::run_custom_job(std::function<void()> f) {
     {
         std::unique_lock<std::mutex> lk(mutex);
-        cv.wait(lk, [&] { return !searching; });
+        cv.wait(lk, [&] { return !searching && !has_pending_epoch(); });
         jobFunc   = std::move(f);
         searching = true;
     }
     cv.notify_one();
 }
 
+void Thread::claim_search_epoch() {
+
+    // Pairs with the store in idle_loop(): either we see the thread spinning,
+    // or the thread sees the new epoch once it stops spinning.
+    if (spinning)
+        return;
+
+    {
+        std::unique_lock<std::mutex> lk(mutex);
+        cv.wait(lk, [&] { return !searching; });
+
+        if (!has_pending_epoch())
+            return;
+
+        ackEpoch  = wakeup.epoch.load();
+        jobFunc   = [this]() { worker->start_searching(); };
+        searching = true;
+    }
+    cv.notify_one();
+}
+
+// Busy waits for a new job or search epoch, up to the configured spin window
+void Thread::spin_for_work() {
+
+    const auto deadline = std::chrono::steady_clock::now()
+                        + std::chrono::microseconds(wakeup.spinMicros.load(std::memory_order_relaxed));
+
+    while (!searching.load(std::memory_order_acquire) && !has_pending_epoch())
+    {
+        for (int i = 0; i < 32; ++i)
+            cpu_relax();
+
+        if (std::chrono::steady_clock::now() > deadline)
+            break;
+    }
+}
+
 void Thread::ensure_network_replicated() { worker->ensure_network_replicated(); }
 
 // Thread gets parked here, blocked on the condition variable
@@ -113,7 +180,27 @@ void Thread::idle_loop() {
         std::unique_lock<std::mutex> lk(mutex);
         searching = false;
         cv.notify_one();  // Wake up anyone waiting for search finished
-        cv.wait(lk, [&] { return searching; });
+
+        // Before parking, poll for a while so that a search started shortly
+        // after does not pay for a futex wake-up and a reschedule.
+        if (wakeup.spinMicros.load(std::memory_order_relaxed) > 0)
+        {
+            spinning = true;
+            lk.unlock();
+            spin_for_work();
+            lk.lock();
+            spinning = false;
+        }
+
+        // Pick up a search started by the pool while we were not parked
+        if (!searching && has_pending_epoch())
+        {
+            ackEpoch  = wakeup.epoch.load();
+            jobFunc   = [this]() { worker->start_searching(); };
+            searching = true;
+        }
+
+        cv.wait(lk, [&] { return searching.load(); });
 
         if (exit)
             return;
@@ -133,6 +220,20 @@ Search::SearchManager* ThreadPool::main_manager() { return main_thread()->worker
 uint64_t ThreadPool::nodes_searched() const { return accumulate(&Search::Worker::nodes); }
 uint64_t ThreadPool::tb_hits() const { return accumulate(&Search::Worker::tbHits); }
 
+Search::SearchStats ThreadPool::search_stats() const {
+
+    Search::SearchStats sum;
+    for (auto&& th : threads)
+    {
+        Search::SearchStats st = th->worker->stats;
+        st.tbHits              = th->worker->tbHits;
+        st.tbCacheProbes       = th->worker->tbCache.probes;
+        st.tbCacheHits         = th->worker->tbCache.hits;
+        sum += st;
+    }
+    return sum;
+}
+
 // Creates/destroys threads to match the requested number.
 // Created and launched threads will immediately go to sleep in idle_loop.
 // Upon resizing, threads are recreated to allow for binding if necessary.
@@ -234,6 +335,34 @@ void ThreadPool::wait_on_thread(size_t threadId) {
 
 size_t ThreadPool::num_threads() const { return threads.size(); }
 
+// Runs job(0) .. job(count - 1) on the calling thread and on the threads from
+// firstThread on, which must be idle. Returns when all the jobs are done.
+void ThreadPool::run_parallel(size_t                            count,
+                              const std::function<void(size_t)>& job,
+                              size_t                            firstThread) {
+
+    if (count == 0)
+        return;
+
+    std::atomic<size_t> next(0);
+
+    auto work = [&]() {
+        for (size_t i; (i = next++) < count;)
+            job(i);
+    };
+
+    // The calling thread takes a share of the jobs itself
+    const size_t lastThread = std::min(threads.size(), firstThread + count - 1);
+
+    for (size_t t = firstThread; t < lastThread; ++t)
+        run_on_thread(t, work);
+
+    work();
+
+    for (size_t t = firstThread; t < lastThread; ++t)
+        wait_on_thread(t);
+}
+
 
 // Wakes up main thread waiting in idle_loop() and returns immediately.
 // Main thread will wake up other threads and start the search.
@@ -264,7 +393,10 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
         for (const auto& m : legalmoves)
             rootMoves.emplace_back(m);
 
-    Tablebases::Config tbConfig = Tablebases::rank_root_moves(options, pos, rootMoves);
+    // The threads are idle, let them probe the root moves in parallel
+    Tablebases::Config tbConfig = Tablebases::rank_root_moves(
+      options, pos, rootMoves, false,
+      [this](size_t count, const std::function<void(size_t)>& job) { run_parallel(count, job); });
 
     // After ownership transfer 'states' becomes empty, so if we stop the search
     // and call 'go' again without setting a new position states.get() == nullptr.
@@ -298,6 +430,47 @@ void ThreadPool::start_thinking(const OptionsMap&  options,
     main_thread()->start_searching();
 }
 
+// Searches a list of positions, each thread taking the next unsearched one
+// from a shared cursor as soon as it is done with its own. Results are
+// reported as they complete, so they may come out of order. Like a 'go', the
+// batch is run by the main thread and this returns immediately; 'onDone' is
+// called once all positions are done or the search is stopped.
+void ThreadPool::analyse_batch(std::vector<std::string>     fens,
+                               const Search::LimitsType&    limits,
+                               const Search::UpdateBatch&   onResult,
+                               const std::function<void()>& onDone) {
+
+    main_thread()->wait_for_search_finished();
+
+    stop = abortedSearch = false;
+    increaseDepth        = true;
+
+    main_thread()->run_custom_job([this, fens = std::move(fens), limits, onResult, onDone]() {
+        std::atomic<size_t> next{0};
+        std::mutex          resultMutex;
+
+        auto report = [&](const Search::InfoBatch& info) {
+            std::lock_guard<std::mutex> lk(resultMutex);
+            onResult(info);
+        };
+
+        auto work = [&](Search::Worker* worker) {
+            for (size_t i = next++; i < fens.size() && !stop; i = next++)
+                worker->batch_search(i, fens[i], limits, report);
+        };
+
+        for (auto&& th : threads)
+            if (th != threads.front())
+                th->run_custom_job([&, worker = th->worker.get()]() { work(worker); });
+
+        work(main_thread()->worker.get());
+
+        wait_for_search_finished();
+
+        onDone();
+    });
+}
+
 Thread* ThreadPool::get_best_thread() const {
 
     Thread* bestThread = threads.front().get();
@@ -365,16 +538,45 @@ Thread* ThreadPool::get_best_thread() const {
 }
 
 
+void ThreadPool::set_spin_wait(int micros) {
+    wakeup.spinMicros.store(micros, std::memory_order_relaxed);
+}
+
 // Start non-main threads.
 // Will be invoked by main thread after it has started searching.
 void ThreadPool::start_searching() {
 
+    wakeup.startTime = std::chrono::steady_clock::now();
+
+    // With spinning enabled, a single epoch increment starts all the helpers
+    // that are still spinning, only the parked ones need to be notified.
+    if (wakeup.spinMicros.load(std::memory_order_relaxed) > 0)
+    {
+        wakeup.epoch.fetch_add(1);
+
+        for (auto&& th : threads)
+            if (th != threads.front())
+                th->claim_search_epoch();
+        return;
+    }
+
     for (auto&& th : threads)
         if (th != threads.front())
             th->start_searching();
 }
 
 
+std::vector<std::chrono::steady_clock::duration> ThreadPool::helper_wakeup_latencies() const {
+
+    std::vector<std::chrono::steady_clock::duration> latencies;
+
+    for (auto&& th : threads)
+        if (th != threads.front())
+            latencies.push_back(th->worker->wakeupLatency);
+
+    return latencies;
+}
+
 // Wait for non-main threads
 void ThreadPool::wait_for_search_finished() const {
 
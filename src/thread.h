@@ -20,14 +20,17 @@
 #define THREAD_H_INCLUDED
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
+#include "memory.h"
 #include "numa.h"
 #include "position.h"
 #include "search.h"
@@ -65,6 +68,18 @@ class OptionalThreadToNumaNodeBinder {
     NumaIndex         numaId;
 };
 
+// Wake-up channel shared by the ThreadPool and its threads. With a non-zero
+// spin window, idle threads poll it for a while before parking on their
+// condition variable, and helpers are started by a single increment of
+// 'epoch' instead of a lock/notify round-trip per thread.
+struct ThreadWakeup {
+    std::atomic<uint64_t> epoch{0};
+    std::atomic<int>      spinMicros{0};
+
+    // When the main thread last started the helpers, see 'wakebench'
+    std::chrono::steady_clock::time_point startTime;
+};
+
 // Abstraction of a thread. It contains a pointer to the worker and a native thread.
 // After construction, the native thread is started with idle_loop()
 // waiting for a signal to start searching.
@@ -93,14 +108,25 @@ class Thread {
     void   wait_for_search_finished();
     size_t id() const { return idx; }
 
-    std::unique_ptr<Search::Worker> worker;
+    // Starts the search for a pool epoch this thread has not picked up yet.
+    // A spinning thread is left alone, it notices the new epoch by itself.
+    void claim_search_epoch();
+
+    LargePagePtr<Search::Worker> worker;
     std::function<void()>           jobFunc;
 
    private:
+    bool has_pending_epoch() const;
+    void spin_for_work();
+
     std::mutex                mutex;
     std::condition_variable   cv;
     size_t                    idx, nthreads;
-    bool                      exit = false, searching = true;  // Set before starting std::thread
+    bool                      exit = false;
+    std::atomic_bool          searching = true;  // Set before starting std::thread
+    std::atomic_bool          spinning  = false;
+    std::atomic<uint64_t>     ackEpoch;
+    const ThreadWakeup&       wakeup;
     NativeThread              stdThread;
     NumaReplicatedAccessToken numaAccessToken;
 };
@@ -130,20 +156,30 @@ class ThreadPool {
     ThreadPool& operator=(ThreadPool&&)      = delete;
 
     void   start_thinking(const OptionsMap&, Position&, StateListPtr&, Search::LimitsType);
+    void   analyse_batch(std::vector<std::string>,
+                         const Search::LimitsType&,
+                         const Search::UpdateBatch&,
+                         const std::function<void()>&);
     void   run_on_thread(size_t threadId, std::function<void()> f);
     void   wait_on_thread(size_t threadId);
+    void   run_parallel(size_t count, const std::function<void(size_t)>& job, size_t firstThread = 0);
     size_t num_threads() const;
     void   clear();
     void   set(const NumaConfig& numaConfig,
                Search::SharedState,
                const Search::SearchManager::UpdateContext&);
+    void   set_spin_wait(int micros);
 
     Search::SearchManager* main_manager();
     Thread*                main_thread() const { return threads.front().get(); }
     uint64_t               nodes_searched() const;
     uint64_t               tb_hits() const;
+    Search::SearchStats    search_stats() const;
     Thread*                get_best_thread() const;
     void                   start_searching();
+
+    // Time each helper took to start its last search once released
+    std::vector<std::chrono::steady_clock::duration> helper_wakeup_latencies() const;
     void                   wait_for_search_finished() const;
 
     std::vector<size_t> get_bound_thread_count_by_numa_node() const;
@@ -151,6 +187,7 @@ class ThreadPool {
     void ensure_network_replicated();
 
     std::atomic_bool stop, abortedSearch, increaseDepth;
+    ThreadWakeup     wakeup;
 
     auto cbegin() const noexcept { return threads.cbegin(); }
     auto begin() noexcept { return threads.begin(); }
@@ -20,16 +20,22 @@
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
 #include <cmath>
 #include <cstdint>
+#include <fstream>
+#include <functional>
 #include <iterator>
+#include <memory>
 #include <optional>
 #include <sstream>
 #include <string_view>
+#include <thread>
 #include <utility>
 #include <vector>
 
 #include "benchmark.h"
+#include "bitboard.h"
 #include "engine.h"
 #include "memory.h"
 #include "movegen.h"
@@ -40,6 +46,7 @@
 #include "ucioption.h"
 #include "learn/learn.h"
 #include "book/book.h"
+#include "book/file_mapping.h"
 
 namespace Judas {
 
@@ -189,10 +196,30 @@ void UCIEngine::loop() {
             bench(is);
         else if (token == BenchmarkCommand)
             benchmark(is);
+        else if (token == "analyse-batch")
+            analyse_batch(is);
+        else if (token == "perft-epd")
+            perft_epd(is);
+        else if (token == "startup-bench")
+            startup_bench(is);
+        else if (token == "wakebench")
+            wakeup_bench(is);
+        else if (token == "pack-epd" || token == "unpack-epd")
+            convert_positions(is, token == "pack-epd");
         else if (token == "d")
             sync_cout << engine.visualize() << sync_endl;
         else if (token == "eval")
             engine.trace_eval();
+        else if (token == "evalbatch")
+            evaluate_batch(is);
+        else if (token == "nnuebench")
+        {
+            int passes;
+            if (!(is >> passes) || passes < 1)
+                passes = 20;
+            const std::string report = engine.nnue_benchmark(passes);
+            sync_cout << report << sync_endl;
+        }
         else if (token == "book")
             engine.show_moves_bookMan(pos);
         else if (token == "showexp")
@@ -201,6 +228,14 @@ void UCIEngine::loop() {
             LD.quick_reset_exp();
         else if (token == "compiler")
             sync_cout << compiler_info() << sync_endl;
+        else if (token == "searchstats")
+        {
+            const std::string stats = engine.search_stats_as_string();
+            sync_cout << (stats.empty() ? "Search statistics are not compiled in, "
+                                          "build with searchstats=yes"
+                                        : stats)
+                      << sync_endl;
+        }
         else if (token == "export_net")
         {
             std::pair<std::optional<std::string>, std::string> files[2];
@@ -346,6 +381,8 @@ void UCIEngine::bench(std::istream& args) {
 
     dbg_print();
 
+    std::cerr << engine.search_stats_as_string();
+
     std::cerr << "\n==========================="    //
               << "\nTotal time (ms) : " << elapsed  //
               << "\nNodes searched  : " << nodes    //
@@ -480,7 +517,7 @@ void UCIEngine::benchmark(std::istream& args) {
 
     dbg_print();
 
-    std::cerr << "\n";
+    std::cerr << "\n" << engine.search_stats_as_string();
 
     static_assert(
       std::size(hashfullAges) == 2 && hashfullAges[0] == 0 && hashfullAges[1] == 999,
@@ -519,17 +556,496 @@ void UCIEngine::benchmark(std::istream& args) {
     init_search_update_listeners();
 }
 
+namespace {
+
+// Returns the FEN of an EPD line: the board, side to move, castling and en
+// passant fields, followed by the move counters only if present. EPD operations
+// are dropped, and an empty string is returned if the line holds no position.
+std::string epd_to_fen(std::string_view line) {
+    std::string_view fields[6];
+    size_t           count = 0;
+
+    for (size_t i = 0, j; count < 6; i = j)
+    {
+        while (i < line.size() && std::isspace((unsigned char) line[i]))
+            ++i;
+
+        if (i == line.size())
+            break;
+
+        for (j = i; j < line.size() && !std::isspace((unsigned char) line[j]); ++j)
+        {}
+
+        fields[count++] = line.substr(i, j - i);
+    }
+
+    if (count < 4 || fields[0][0] == '#')
+        return {};
+
+    const bool hasCounters = count == 6
+                          && std::all_of(fields[4].begin(), fields[4].end(), ::isdigit)
+                          && std::all_of(fields[5].begin(), fields[5].end(), ::isdigit);
+
+    std::string fen;
+    fen.reserve(line.size());
+
+    for (size_t f = 0; f < (hasCounters ? 6 : 4); ++f)
+        fen.append(f ? " " : "").append(fields[f]);
+
+    return fen;
+}
+
+// Reads the positions of an EPD file in file order. The file is memory mapped
+// and cut at line boundaries into chunks that are parsed by the search threads.
+std::optional<std::vector<std::string>> read_epd(Engine& engine, const std::string& fileName) {
+
+    constexpr size_t ChunkSize = 1 << 16;
+
+    FileMapping mapping;
+
+    if (!mapping.map(fileName, false, true))
+    {
+        // FileMapping refuses empty files, which just hold no positions
+        std::ifstream file(fileName, std::ios::binary);
+        if (file.is_open() && file.peek() == std::ifstream::traits_type::eof())
+            return std::vector<std::string>{};
+
+        return std::nullopt;
+    }
+
+    const std::string_view text(reinterpret_cast<const char*>(mapping.data()),
+                                mapping.data_size());
+    const size_t           chunks = std::min<size_t>(text.size() / ChunkSize + 1, 1024);
+
+    // A chunk starts past the first line break before or at its nominal start
+    const auto boundary = [&](size_t k) {
+        if (k == 0 || k == chunks)
+            return k ? text.size() : 0;
+
+        const size_t lineEnd = text.find('\n', k * (text.size() / chunks) - 1);
+        return lineEnd == std::string_view::npos ? text.size() : lineEnd + 1;
+    };
+
+    std::vector<std::vector<std::string>> parts(chunks);
+
+    engine.run_parallel(chunks, [&](size_t k) {
+        std::string_view rest = text.substr(boundary(k), boundary(k + 1) - boundary(k));
+
+        while (!rest.empty())
+        {
+            const size_t lineEnd = std::min(rest.find('\n'), rest.size());
+            std::string  fen     = epd_to_fen(rest.substr(0, lineEnd));
+
+            if (!fen.empty())
+                parts[k].push_back(std::move(fen));
+
+            rest.remove_prefix(std::min(lineEnd + 1, rest.size()));
+        }
+    });
+
+    std::vector<std::string> fens;
+
+    for (auto& part : parts)
+        std::move(part.begin(), part.end(), std::back_inserter(fens));
+
+    return fens;
+}
+
+}  // namespace
+
+// Analyses every position of an EPD/FEN file, one position per thread, and
+// prints a result line for each as soon as it is done. The remaining arguments
+// are parsed as 'go' limits; only depth and nodes are honoured per position.
+void UCIEngine::analyse_batch(std::istream& args) {
+    std::string fileName;
+
+    if (!(args >> fileName))
+    {
+        sync_cout << "Usage: analyse-batch <file> [depth N] [nodes N]" << sync_endl;
+        return;
+    }
+
+    const auto fens = read_epd(engine, fileName);
+    if (!fens)
+    {
+        sync_cout << "Unable to open file " << fileName << sync_endl;
+        return;
+    }
+
+    Search::LimitsType limits = parse_limits(args);
+    if (!limits.depth && !limits.nodes)
+        limits.depth = 13;
+
+    // The batch runs on the search threads, so that 'stop' and 'quit' are
+    // still read. Results are reported one at a time, then the summary.
+    auto      nodes     = std::make_shared<uint64_t>(0);
+    auto      results   = std::make_shared<size_t>(0);
+    TimePoint startTime = now();
+
+    engine.analyse_batch(
+      std::move(*fens), limits,
+      [nodes, results](const Engine::InfoBatch& info) {
+          *nodes += info.nodes;
+          ++*results;
+          on_batch_result(info);
+      },
+      [nodes, results, startTime]() {
+          // Ensure positivity to avoid a 'divide by zero'
+          const TimePoint elapsed = now() - startTime + 1;
+
+          std::cerr << "\n==========================="     //
+                    << "\nPositions       : " << *results  //
+                    << "\nTotal time (ms) : " << elapsed   //
+                    << "\nNodes searched  : " << *nodes    //
+                    << "\nNodes/second    : " << 1000 * *nodes / elapsed << std::endl;
+      });
+}
+
+void UCIEngine::evaluate_batch(std::istream& args) {
+    std::string fileName;
+
+    if (!(args >> fileName))
+    {
+        sync_cout << "Usage: evalbatch <file>" << sync_endl;
+        return;
+    }
+
+    const auto fens = read_epd(engine, fileName);
+    if (!fens)
+    {
+        sync_cout << "Unable to open file " << fileName << sync_endl;
+        return;
+    }
+
+    TimePoint elapsed = now();
+
+    engine.evaluate_batch(*fens, [](size_t index, const std::optional<Score>& score) {
+        sync_cout << "result " << index << " score "
+                  << (score ? format_score(*score) : std::string("none")) << sync_endl;
+    });
+
+    elapsed = now() - elapsed + 1;  // Ensure positivity to avoid a 'divide by zero'
+
+    std::cerr << "\n==========================="                       //
+              << "\nPositions       : " << fens->size()                 //
+              << "\nTotal time (ms) : " << elapsed                     //
+              << "\nPositions/second: " << 1000 * fens->size() / elapsed << std::endl;
+}
+
 void UCIEngine::setoption(std::istringstream& is) {
     engine.wait_for_search_finished();
     engine.get_options().setoption(is);
 }
 
 std::uint64_t UCIEngine::perft(const Search::LimitsType& limits) {
-    auto nodes = engine.perft(engine.fen(), limits.perft, engine.get_options()["UCI_Chess960"]);
+    auto nodes = engine.perft(engine.fen(), limits.perft, engine.get_options()["UCI_Chess960"],
+                              size_t(engine.get_options()["Hash"]));
     sync_cout << "\nNodes searched: " << nodes << "\n" << sync_endl;
     return nodes;
 }
 
+// Verifies the perft counts of an EPD file with lines such as
+// "<fen> ;D1 20 ;D2 400 ;D3 8902", skipping the depths above the optional
+// limit, and prints the outcome and speed of every count. The perft table is
+// as large as the Hash option unless a size in MB is given, 0 for none.
+void UCIEngine::perft_epd(std::istream& args) {
+    std::string fileName;
+    Depth       maxDepth = MAX_PLY;
+    size_t      hashMB   = size_t(engine.get_options()["Hash"]);
+
+    if (!(args >> fileName))
+    {
+        sync_cout << "Usage: perft-epd <file> [max depth] [hash MB]" << sync_endl;
+        return;
+    }
+
+    args >> maxDepth >> hashMB;
+
+    std::ifstream file(fileName);
+    if (!file.is_open())
+    {
+        sync_cout << "Unable to open file " << fileName << sync_endl;
+        return;
+    }
+
+    std::vector<std::pair<std::string, Depth>> jobs;
+    std::vector<uint64_t>                      expected;
+    std::vector<size_t>                        position;
+    std::string                                line;
+    size_t                                     positions = 0;
+
+    while (std::getline(file, line))
+    {
+        std::istringstream ls(line);
+        std::string        fen, field, token;
+
+        if (!std::getline(ls, fen, ';') || !(std::istringstream(fen) >> token) || token[0] == '#')
+            continue;
+
+        ++positions;
+
+        while (std::getline(ls, field, ';'))
+        {
+            std::istringstream fs(field);
+            char               d;
+            Depth              depth;
+            uint64_t           count;
+
+            if ((fs >> d >> depth >> count) && (d == 'D' || d == 'd') && depth <= maxDepth)
+            {
+                jobs.emplace_back(fen, depth);
+                expected.push_back(count);
+                position.push_back(positions);
+            }
+        }
+    }
+
+    size_t    passed = 0;
+    uint64_t  nodes  = 0;
+    TimePoint start  = now(), last = start;
+
+    engine.perft_batch(jobs, engine.get_options()["UCI_Chess960"], hashMB,
+                       [&](size_t i, uint64_t count) {
+                           const TimePoint elapsed = now() - last + 1;
+                           const bool      ok      = count == expected[i];
+
+                           nodes += count;
+                           passed += ok;
+                           last = now();
+
+                           sync_cout << "position " << position[i] << " depth " << jobs[i].second
+                                     << ": " << count
+                                     << (ok ? " ok" : " FAILED, expected ")
+                                     << (ok ? "" : std::to_string(expected[i])) << ", "
+                                     << elapsed << " ms, " << 1000 * count / elapsed
+                                     << " nodes/second" << sync_endl;
+                       });
+
+    const TimePoint elapsed = now() - start + 1;  // Ensure positivity to avoid a 'divide by zero'
+
+    std::cerr << "\n==========================="              //
+              << "\nPositions       : " << positions         //
+              << "\nCounts passed   : " << passed            //
+              << "\nCounts failed   : " << jobs.size() - passed  //
+              << "\nTotal time (ms) : " << elapsed           //
+              << "\nNodes/second    : " << 1000 * nodes / elapsed << std::endl;
+}
+
+// Times the initialization stages that run before the first command can be
+// served, averaged over the given number of runs.
+void UCIEngine::startup_bench(std::istream& args) {
+    int runs;
+
+    if (!(args >> runs) || runs < 1)
+        runs = 10;
+
+    const auto average_us = [runs](const std::function<void()>& stage) {
+        const auto start = std::chrono::steady_clock::now();
+
+        for (int i = 0; i < runs; ++i)
+            stage();
+
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        return std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() / runs;
+    };
+
+    engine.wait_for_search_finished();
+
+    const auto bitboards = average_us(Bitboards::init);
+    const auto position  = average_us(Position::init);
+    const auto networks  = average_us([&] { engine.load_networks(); });
+
+    std::cerr << "\n==========================="                           //
+              << "\nRuns                 : " << runs                      //
+              << "\nBitboards init [us]  : " << bitboards                 //
+              << "\nPosition init [us]   : " << position                  //
+              << "\nNetworks load [us]   : " << networks                  //
+              << "\nTotal [us]           : " << bitboards + position + networks << std::endl;
+}
+
+// Measures how long the helper threads take to start searching once the main
+// thread releases them, first with 'Thread Spin Wait' off and then with the
+// given spin window. Each run is a 'go depth 1' from the current position,
+// started 'gap' microseconds after the previous one has finished.
+void UCIEngine::wakeup_bench(std::istream& args) {
+    int searches, spin, gap;
+
+    if (!(args >> searches) || searches < 1)
+        searches = 200;
+    if (!(args >> spin) || spin < 1)
+        spin = 1000;
+    if (!(args >> gap) || gap < 0)
+        gap = 100;
+
+    auto& options = engine.get_options();
+
+    if (int(options["Threads"]) < 2)
+    {
+        sync_cout << "info string wakebench needs Threads > 1" << sync_endl;
+        return;
+    }
+
+    const int savedSpin = options["Thread Spin Wait"];
+
+    engine.set_on_update_full([](const auto&) {});
+    engine.set_on_iter([](const auto&) {});
+    engine.set_on_update_no_moves([](const auto&) {});
+    engine.set_on_bestmove([](const auto&, const auto&) {});
+    engine.set_on_verify_networks([](const auto&) {});
+
+    const auto measure = [&](int spinMicros) {
+        auto ss = std::istringstream("name Thread Spin Wait value " + std::to_string(spinMicros));
+        setoption(ss);
+
+        std::vector<int64_t> latencies;
+
+        for (int i = 0; i < searches; ++i)
+        {
+            Search::LimitsType limits;
+            limits.startTime = now();
+            limits.depth     = 1;
+
+            std::this_thread::sleep_for(std::chrono::microseconds(gap));
+            engine.go(limits);
+            engine.wait_for_search_finished();
+
+            for (auto latency : engine.helper_wakeup_latencies())
+                latencies.push_back(
+                  std::chrono::duration_cast<std::chrono::nanoseconds>(latency).count());
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+
+        std::ostringstream summary;
+        summary << latencies[latencies.size() / 2] / 1000.0 << ", "
+                << latencies[latencies.size() * 9 / 10] / 1000.0 << ", "
+                << latencies.back() / 1000.0;
+        return summary.str();
+    };
+
+    const std::string parked  = measure(0);
+    const std::string spinned = measure(spin);
+
+    auto ss = std::istringstream("name Thread Spin Wait value " + std::to_string(savedSpin));
+    setoption(ss);
+
+    init_search_update_listeners();
+
+    std::cerr << "\n==========================="                              //
+              << "\nThreads                    : " << int(options["Threads"])   //
+              << "\nSearches                   : " << searches                  //
+              << "\nGap between searches [us]  : " << gap                       //
+              << "\nSpin window [us]           : " << spin                      //
+              << "\nHelper wake-up [us]        : median, p90, max"              //
+              << "\n    parked                 : " << parked                    //
+              << "\n    spinning               : " << spinned << std::endl;
+}
+
+// Converts the positions of an EPD file into a file of PackedPosition records,
+// or such a file back into FENs, one per line. The positions are converted in
+// blocks by the search threads, and the ones the format cannot hold are skipped.
+void UCIEngine::convert_positions(std::istream& args, bool pack) {
+
+    constexpr size_t BlockSize = 4096;
+
+    std::string inName, outName;
+
+    if (!(args >> inName >> outName))
+    {
+        sync_cout << "Usage: " << (pack ? "pack-epd" : "unpack-epd") << " <input> <output>"
+                  << sync_endl;
+        return;
+    }
+
+    const bool isChess960 = engine.get_options()["UCI_Chess960"];
+
+    std::vector<std::string>    fens;
+    std::vector<PackedPosition> packed;
+    TimePoint                   elapsed = now();
+
+    if (pack)
+    {
+        auto epd = read_epd(engine, inName);
+        if (!epd)
+        {
+            sync_cout << "Unable to open file " << inName << sync_endl;
+            return;
+        }
+
+        fens = std::move(*epd);
+        packed.resize(fens.size());
+    }
+    else
+    {
+        std::ifstream in(inName, std::ios::binary | std::ios::ate);
+        if (!in.is_open())
+        {
+            sync_cout << "Unable to open file " << inName << sync_endl;
+            return;
+        }
+
+        if (in.tellg() % sizeof(PackedPosition))
+        {
+            sync_cout << "File " << inName << " is not a sequence of " << sizeof(PackedPosition)
+                      << " byte records" << sync_endl;
+            return;
+        }
+
+        in.seekg(0);
+
+        for (PackedPosition p; in.read(reinterpret_cast<char*>(p.data), sizeof(p.data));)
+            packed.push_back(p);
+
+        fens.resize(packed.size());
+    }
+
+    std::vector<uint8_t> valid(fens.size());
+
+    engine.run_parallel((fens.size() + BlockSize - 1) / BlockSize, [&](size_t block) {
+        StateInfo st;
+        Position  pos;
+
+        for (size_t i = block * BlockSize; i < std::min(fens.size(), (block + 1) * BlockSize); ++i)
+            if (pack)
+                valid[i] = pos.set(fens[i], isChess960, &st).pack(packed[i]);
+            else if (pos.unpack(packed[i], isChess960, &st))
+            {
+                valid[i] = true;
+                fens[i]  = pos.fen();
+            }
+    });
+
+    std::ofstream out(outName, pack ? std::ios::binary : std::ios::out);
+    size_t        converted = 0;
+
+    for (size_t i = 0; i < fens.size(); ++i)
+    {
+        if (!valid[i])
+            continue;
+
+        ++converted;
+
+        if (pack)
+            out.write(reinterpret_cast<const char*>(packed[i].data), sizeof(packed[i].data));
+        else
+            out << fens[i] << '\n';
+    }
+
+    if (!out)
+    {
+        sync_cout << "Unable to write file " << outName << sync_endl;
+        return;
+    }
+
+    elapsed = now() - elapsed + 1;  // Ensure positivity to avoid a 'divide by zero'
+
+    std::cerr << "\n==========================="                        //
+              << "\nPositions       : " << converted                   //
+              << "\nSkipped         : " << fens.size() - converted     //
+              << "\nTotal time (ms) : " << elapsed                     //
+              << "\nPositions/second: " << 1000 * fens.size() / elapsed << std::endl;
+}
+
 void UCIEngine::position(std::istringstream& is) {
     std::string token, fen;
 
@@ -693,8 +1209,13 @@ std::string UCIEngine::to_lower(std::string str) {
 Move UCIEngine::to_move(const Position& pos, std::string str) {
     str = to_lower(str);
 
+    if (str.size() < 4)
+        return Move::none();
+
+    // Spell out only the moves that leave from the right square
     for (const auto& m : MoveList<LEGAL>(pos))
-        if (str == move(m, pos.is_chess960()))
+        if (str[0] == 'a' + file_of(m.from_sq()) && str[1] == '1' + rank_of(m.from_sq())
+            && str == move(m, pos.is_chess960()))
             return m;
 
     return Move::none();
@@ -740,6 +1261,21 @@ void UCIEngine::on_iter(const Engine::InfoIter& info) {
     sync_cout << ss.str() << sync_endl;
 }
 
+void UCIEngine::on_batch_result(const Engine::InfoBatch& info) {
+    std::stringstream ss;
+
+    ss << "result " << info.index                 //
+       << " depth " << info.depth                 //
+       << " score " << format_score(info.score)  //
+       << " nodes " << info.nodes                 //
+       << " bestmove " << info.bestmove;          //
+
+    if (!info.pv.empty())
+        ss << " pv " << info.pv;
+
+    sync_cout << ss.str() << sync_endl;
+}
+
 void UCIEngine::on_bestmove(std::string_view bestmove, std::string_view ponder) {
     sync_cout << "bestmove " << bestmove;
     if (!ponder.empty())
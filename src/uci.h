@@ -66,14 +66,21 @@ class UCIEngine {
     void          go(std::istringstream& is);
     void          bench(std::istream& args);
     void          benchmark(std::istream& args);
+    void          analyse_batch(std::istream& args);
+    void          evaluate_batch(std::istream& args);
     void          position(std::istringstream& is);
     void          setoption(std::istringstream& is);
     std::uint64_t perft(const Search::LimitsType&);
+    void          perft_epd(std::istream& args);
+    void          startup_bench(std::istream& args);
+    void          wakeup_bench(std::istream& args);
+    void          convert_positions(std::istream& args, bool pack);
 
     static void on_update_no_moves(const Engine::InfoShort& info);
     static void on_update_full(const Engine::InfoFull& info, bool showWDL);
     static void on_iter(const Engine::InfoIter& info);
     static void on_bestmove(std::string_view bestmove, std::string_view ponder);
+    static void on_batch_result(const Engine::InfoBatch& info);
 
     void init_search_update_listeners();
 };
@@ -176,6 +176,25 @@ cat << EOF > syzygy.exp
  send "position fen 8/1P6/2B5/8/4K3/8/6k1/8 w - - 0 1\n"
  send "go depth 5\n"
  expect "bestmove"
+
+ # many threads mapping, probing and caching the same tables at once, first
+ # with lazy mapping, then racing the background warm-up
+ send "setoption name Threads value 8\n"
+ foreach prefetch {0 5} {
+   send "setoption name SyzygyPrefetch value \$prefetch\n"
+   send "ucinewgame\n"
+   foreach fen {"4k3/8/8/8/8/8/3PP3/4K3 w - - 0 1"
+                "8/8/4k3/8/2n5/8/3PK3/1R6 w - - 0 1"
+                "8/2k5/8/8/8/1q6/8/3QK3 w - - 0 1"
+                "7k/8/8/8/8/1K6/1PP5/7r w - - 0 1"
+                "8/8/8/8/8/4k3/1r6/R3K3 b - - 0 1"} {
+     send "position fen \$fen\n"
+     send "go nodes 20000\n"
+     expect "bestmove"
+     send "go depth 12\n"
+     expect "bestmove"
+   }
+ }
  send "quit\n"
  expect eof
 
@@ -29,4 +29,24 @@ expect perft.exp "fen r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4
 
 rm perft.exp
 
+# the same positions through perft-epd, which shares one perft table, as large
+# as the Hash option, between the threads and across the positions
+cat << EOF > perft_tmp.epd
+rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1 ;D1 20 ;D2 400 ;D3 8902 ;D4 197281 ;D5 4865609
+r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - ;D1 48 ;D2 2039 ;D3 97862 ;D4 4085603
+8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - ;D1 14 ;D2 191 ;D3 2812 ;D4 43238 ;D5 674624 ;D6 11030083
+r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1 ;D1 6 ;D2 264 ;D3 9467 ;D4 422333
+rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8 ;D1 44 ;D2 1486 ;D3 62379 ;D4 2103487
+r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10 ;D1 46 ;D2 2079 ;D3 89890 ;D4 3894594
+EOF
+
+printf "setoption name Threads value 4\nperft-epd perft_tmp.epd\nquit\n" | ./stockfish 2>&1 \
+  | grep -q "Counts failed   : 0"
+
+# and without a perft table up to depth 4
+printf "setoption name Threads value 4\nperft-epd perft_tmp.epd 4 0\nquit\n" | ./stockfish 2>&1 \
+  | grep -q "Counts failed   : 0"
+
+rm perft_tmp.epd
+
 echo "perft testing OK"